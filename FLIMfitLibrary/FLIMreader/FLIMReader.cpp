@@ -0,0 +1,145 @@
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+#include "FLIMReader.h"
+#include "SDTReader.h"
+#include "PTUReader.h"
+#include "FlagDefinitions.h"
+
+#include <string>
+#include <algorithm>
+#include <cctype>
+
+/**
+ * Open a reader for a file, choosing the format from the file extension
+ */
+int FLIMReader::CreateReader(const char* filename, FLIMReader*& reader)
+{
+   reader = NULL;
+
+   std::string ext(filename);
+   size_t dot = ext.find_last_of('.');
+   if (dot == std::string::npos)
+      return ERR_INVALID_INPUT;
+
+   ext = ext.substr(dot+1);
+   std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+   FLIMReader* r;
+   if (ext == "sdt")
+      r = new SDTReader(); //ok
+   else if (ext == "ptu" || ext == "pt3")
+      r = new PTUReader(); //ok
+   else
+      return ERR_INVALID_INPUT;
+
+   int err = r->Map(filename);
+   if (err == SUCCESS)
+      err = r->ReadHeader();
+
+   if (err != SUCCESS)
+   {
+      delete r;
+      return err;
+   }
+
+   reader = r;
+   return SUCCESS;
+}
+
+FLIMReader::FLIMReader()
+{
+   file_ptr = NULL;
+   file_size = 0;
+
+   data_class = DATA_UINT16;
+   n_im = 0;
+   n_x = 0;
+   n_y = 0;
+   n_chan = 0;
+
+   dt = 0;
+   n_t_native = 0;
+
+   time_div = 1;
+   supports_time_binning = false;
+
+   n_thread = 1;
+}
+
+int FLIMReader::Map(const char* filename)
+{
+   using namespace boost::interprocess;
+
+   try
+   {
+      file_map = file_mapping(filename, read_only);
+      file_region = mapped_region(file_map, read_only);
+   }
+   catch(std::exception& e)
+   {
+      e = e;
+      return ERR_COULD_NOT_OPEN_MAPPED_FILE;
+   }
+
+   file_ptr = (const char*) file_region.get_address();
+   file_size = file_region.get_size();
+
+   return SUCCESS;
+}
+
+void FLIMReader::SetNumThreads(int n_thread)
+{
+   this->n_thread = std::max(n_thread, 1);
+}
+
+/**
+ * Combine every time_div time bins into one. Only used by formats 
+ * where the native bins are very fine (TTTR)
+ */
+void FLIMReader::SetTimeBinning(int time_div)
+{
+   if (supports_time_binning)
+      this->time_div = std::max(time_div, 1);
+}
+
+int FLIMReader::GetNumTimebins()
+{
+   return (n_t_native + time_div - 1) / time_div;
+}
+
+/**
+ * Get the start time of each (binned) time bin, in ps
+ */
+void FLIMReader::GetTimepoints(double* t)
+{
+   int n_t = GetNumTimebins();
+   for(int i=0; i<n_t; i++)
+      t[i] = i * time_div * dt;
+}
@@ -0,0 +1,98 @@
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+#ifndef _FLIMREADER_H
+#define _FLIMREADER_H
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Base class for native readers of instrument files. Readers map the file
+ * and build images on request so that the whole dataset is never held in 
+ * memory. Images are returned in the layout expected by FLIMData,
+ * [y][x][chan][t], with values of type GetDataClass()
+ */
+class FLIMReader
+{
+public:
+
+   static int CreateReader(const char* filename, FLIMReader*& reader);
+
+   virtual ~FLIMReader() {};
+
+   /**
+    * Build image im into data, which must have space for 
+    * n_x * n_y * n_chan * n_t values. Safe to call from several threads
+    */
+   virtual int ReadImage(int im, void* data) = 0;
+
+   void SetNumThreads(int n_thread);
+   void SetTimeBinning(int time_div);
+
+   int GetDataClass() { return data_class; }
+   int GetNumImages() { return n_im; }
+   int GetNumX() { return n_x; }
+   int GetNumY() { return n_y; }
+   int GetNumChannels() { return n_chan; }
+   int GetNumTimebins();
+
+   void GetTimepoints(double* t);
+
+protected:
+
+   FLIMReader();
+
+   int Map(const char* filename);
+   virtual int ReadHeader() = 0;
+
+   boost::interprocess::file_mapping file_map;
+   boost::interprocess::mapped_region file_region;
+   const char* file_ptr;
+   size_t file_size;
+
+   int data_class;
+   int n_im;
+   int n_x;
+   int n_y;
+   int n_chan;
+
+   // Time bin width in ps and number of bins before binning
+   double dt;
+   int n_t_native;
+
+   int time_div;
+   bool supports_time_binning;
+
+   int n_thread;
+};
+
+#endif
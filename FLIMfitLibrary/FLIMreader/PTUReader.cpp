@@ -0,0 +1,466 @@
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+#include "PTUReader.h"
+#include "FlagDefinitions.h"
+#include "omp_stub.h"
+
+#include <cstring>
+#include <string>
+#include <algorithm>
+
+#define rtPicoHarpT3     0x00010303
+#define rtHydraHarpT3    0x00010304
+#define rtHydraHarp2T3   0x01010304
+#define rtTimeHarp260NT3 0x00010305
+#define rtTimeHarp260PT3 0x00010306
+#define rtMultiHarpT3    0x00010307
+
+#define tyEmpty8      0xFFFF0008
+#define tyBool8       0x00000008
+#define tyInt8        0x10000008
+#define tyBitSet64    0x11000008
+#define tyColor8      0x12000008
+#define tyFloat8      0x20000008
+#define tyTDateTime   0x21000008
+#define tyFloat8Array 0x2001FFFF
+#define tyAnsiString  0x4001FFFF
+#define tyWideString  0x4002FFFF
+#define tyBinaryBlob  0xFFFFFFFF
+
+// Offsets into the legacy PicoHarp .pt3 header
+#define PT3_RESOLUTION    584
+#define PT3_CNT_RATE0     704
+#define PT3_RECORDS       720
+#define PT3_IMG_HDR_SIZE  724
+#define PT3_IMG_HDR       728
+
+#define PT3_LSM_IDENT     3
+
+namespace
+{
+   template <typename T>
+   T Get(const char* ptr, size_t offset)
+   {
+      T v;
+      memcpy(&v, ptr + offset, sizeof(T));
+      return v;
+   }
+
+   struct PTUTagHead
+   {
+      char     ident[32];
+      int32_t  idx;
+      uint32_t type;
+      int64_t  value;
+   };
+
+   /*
+      Get the bit of a marker channel (1..15) in the marker bits of a record
+   */
+   bool GetMarkerMask(int64_t marker, int& mask)
+   {
+      if (marker < 1 || marker > 15)
+         return false;
+
+      mask = 1 << (marker - 1);
+      return true;
+   }
+}
+
+PTUReader::PTUReader()
+{
+   rec_type = 0;
+   records = NULL;
+   n_records = 0;
+
+   // Default marker bits used by PicoQuant scanning systems
+   line_start_mask = 1;
+   line_stop_mask  = 2;
+   frame_mask      = 4;
+
+   line_duration = 0;
+
+   supports_time_binning = true;
+}
+
+int PTUReader::ReadHeader()
+{
+   int err;
+   if (file_size >= 8 && memcmp(file_ptr, "PQTTTR", 6) == 0)
+      err = ReadPTUHeader();
+   else if (file_size >= PT3_IMG_HDR && memcmp(file_ptr, "PicoHarp 300", 12) == 0)
+      err = ReadPT3Header();
+   else
+      err = ERR_INVALID_INPUT;
+
+   if (err != SUCCESS)
+      return err;
+
+   switch(rec_type)
+   {
+   case rtPicoHarpT3:
+   case rtHydraHarpT3:
+   case rtHydraHarp2T3:
+   case rtTimeHarp260NT3:
+   case rtTimeHarp260PT3:
+   case rtMultiHarpT3:
+      break;
+   default:
+      return ERR_INVALID_INPUT; // only T3 mode data can be used for FLIM
+   }
+
+   return IndexRecords();
+}
+
+int PTUReader::ReadPTUHeader()
+{
+   size_t pos = 16;
+   uint64_t record_offset = 0;
+   double resolution = 0;
+   int pix_x = 0, pix_y = 0;
+
+   while(pos + sizeof(PTUTagHead) <= file_size)
+   {
+      PTUTagHead tag;
+      memcpy(&tag, file_ptr + pos, sizeof(tag));
+      pos += sizeof(tag);
+
+      std::string ident(tag.ident, strnlen(tag.ident, sizeof(tag.ident)));
+
+      if (tag.type == tyFloat8Array || tag.type == tyAnsiString || 
+          tag.type == tyWideString  || tag.type == tyBinaryBlob)
+      {
+         if (tag.value < 0 || (uint64_t) tag.value > file_size - pos)
+            return ERR_FAILED_TO_MAP_DATA;
+         pos += (size_t) tag.value;
+      }
+
+      double fvalue;
+      memcpy(&fvalue, &tag.value, sizeof(fvalue));
+
+      if (ident == "Header_End")
+      {
+         record_offset = pos;
+         break;
+      }
+      else if (ident == "TTResultFormat_TTTRRecType")
+         rec_type = (int) tag.value;
+      else if (ident == "TTResult_NumberOfRecords")
+         n_records = tag.value;
+      else if (ident == "MeasDesc_Resolution")
+         resolution = fvalue;
+      else if (ident == "ImgHdr_PixX")
+         pix_x = (int) tag.value;
+      else if (ident == "ImgHdr_PixY")
+         pix_y = (int) tag.value;
+      else if (ident == "ImgHdr_LineStart")
+      {
+         if (!GetMarkerMask(tag.value, line_start_mask))
+            return ERR_INVALID_INPUT;
+      }
+      else if (ident == "ImgHdr_LineStop")
+      {
+         if (!GetMarkerMask(tag.value, line_stop_mask))
+            return ERR_INVALID_INPUT;
+      }
+      else if (ident == "ImgHdr_Frame")
+      {
+         if (!GetMarkerMask(tag.value, frame_mask))
+            return ERR_INVALID_INPUT;
+      }
+   }
+
+   if (record_offset == 0)
+      return ERR_FAILED_TO_MAP_DATA;
+
+   n_records = std::min(n_records, (uint64_t) (file_size - record_offset) / sizeof(uint32_t));
+   records = (const uint32_t*) (file_ptr + record_offset);
+
+   dt = resolution * 1e12;
+   n_x = pix_x;
+   n_y = pix_y;
+
+   return SUCCESS;
+}
+
+int PTUReader::ReadPT3Header()
+{
+   rec_type = rtPicoHarpT3;
+
+   dt = Get<float>(file_ptr, PT3_RESOLUTION) * 1e3; // ns -> ps
+
+   int img_hdr_size = Get<int32_t>(file_ptr, PT3_IMG_HDR_SIZE);
+   uint64_t record_offset = PT3_IMG_HDR + 4 * (uint64_t) std::max(img_hdr_size, 0);
+   if (record_offset > file_size)
+      return ERR_FAILED_TO_MAP_DATA;
+
+   // The LSM imaging header gives us the markers and image size
+   if (img_hdr_size >= 8 && Get<int32_t>(file_ptr, PT3_IMG_HDR + 4) == PT3_LSM_IDENT)
+   {
+      const char* img_hdr = file_ptr + PT3_IMG_HDR;
+      if (!GetMarkerMask(Get<int32_t>(img_hdr, 8), frame_mask) ||
+          !GetMarkerMask(Get<int32_t>(img_hdr, 12), line_start_mask) ||
+          !GetMarkerMask(Get<int32_t>(img_hdr, 16), line_stop_mask))
+         return ERR_INVALID_INPUT;
+      n_x = Get<int32_t>(img_hdr, 24);
+      n_y = Get<int32_t>(img_hdr, 28);
+   }
+
+   n_records = Get<uint32_t>(file_ptr, PT3_RECORDS);
+   n_records = std::min(n_records, (uint64_t) (file_size - record_offset) / sizeof(uint32_t));
+   records = (const uint32_t*) (file_ptr + record_offset);
+
+   return SUCCESS;
+}
+
+/**
+ * Decode a T3 record. Returns the type of event; for photons chan and dtime 
+ * are set, for markers chan is set to the marker bits. ofl accumulates the 
+ * overflow count and sync is set to the time of the event in sync periods
+ */
+inline int PTUReader::DecodeRecord(uint32_t rec, uint64_t& ofl, uint64_t& sync, int& chan, int& dtime)
+{
+   if (rec_type == rtPicoHarpT3)
+   {
+      uint32_t nsync = rec & 0xFFFF;
+      dtime = (rec >> 16) & 0xFFF;
+      chan  = (rec >> 28) & 0xF;
+
+      if (chan == 0xF)
+      {
+         if (dtime == 0)
+         {
+            ofl += 0x10000;
+            return EVENT_NONE;
+         }
+         chan = dtime & 0xF;
+         sync = ofl + nsync;
+         return EVENT_MARKER;
+      }
+
+      chan--; // PicoHarp channels are numbered from 1
+      sync = ofl + nsync;
+      return EVENT_PHOTON;
+   }
+   else
+   {
+      uint32_t nsync = rec & 0x3FF;
+      dtime = (rec >> 10) & 0x7FFF;
+      chan  = (rec >> 25) & 0x3F;
+      bool special = (rec >> 31) != 0;
+
+      if (special)
+      {
+         if (chan == 0x3F)
+         {
+            if (nsync == 0 || rec_type == rtHydraHarpT3)
+               ofl += 0x400;
+            else
+               ofl += 0x400 * (uint64_t) nsync;
+            return EVENT_NONE;
+         }
+         sync = ofl + nsync;
+         return (chan >= 1 && chan <= 15) ? EVENT_MARKER : EVENT_NONE;
+      }
+
+      sync = ofl + nsync;
+      return EVENT_PHOTON;
+   }
+}
+
+/**
+ * Run through the records once to find where each frame starts, the 
+ * number of channels and time bins used and the duration of a line
+ */
+int PTUReader::IndexRecords()
+{
+   uint64_t ofl = 0, sync = 0;
+   int chan, dtime;
+
+   int max_chan = -1;
+   int max_dtime = -1;
+   int n_line_first_frame = 0;
+   bool first_frame = true;
+
+   uint64_t line_start = 0;
+   bool in_line = false;
+   double line_duration_sum = 0;
+   int n_line_measured = 0;
+
+   frame_start.clear();
+   frame_start.push_back(0);
+
+   for(uint64_t i=0; i<n_records; i++)
+   {
+      int ev = DecodeRecord(records[i], ofl, sync, chan, dtime);
+
+      if (ev == EVENT_PHOTON)
+      {
+         max_chan  = std::max(max_chan, chan);
+         max_dtime = std::max(max_dtime, dtime);
+      }
+      else if (ev == EVENT_MARKER)
+      {
+         if (chan & frame_mask)
+         {
+            if (n_line_first_frame > 0)
+               first_frame = false;
+            if (i + 1 > frame_start.back() + 1)
+               frame_start.push_back(i + 1);
+            in_line = false;
+         }
+         if (chan & line_start_mask)
+         {
+            if (in_line && n_line_measured < 16)
+            {
+               // No stop marker; measure from one line start to the next
+               line_duration_sum += (double) (sync - line_start);
+               n_line_measured++;
+            }
+            line_start = sync;
+            in_line = true;
+            if (first_frame)
+               n_line_first_frame++;
+         }
+         if ((chan & line_stop_mask) && in_line)
+         {
+            if (n_line_measured < 16)
+            {
+               line_duration_sum += (double) (sync - line_start);
+               n_line_measured++;
+            }
+            in_line = false;
+         }
+      }
+   }
+
+   if (n_line_measured == 0 || max_chan < 0)
+      return ERR_FAILED_TO_MAP_DATA;
+
+   line_duration = line_duration_sum / n_line_measured;
+
+   if (n_y <= 0)
+      n_y = n_line_first_frame;
+   if (n_x <= 0)
+      n_x = n_y;
+   if (n_x <= 0 || n_y <= 0)
+      return ERR_FAILED_TO_MAP_DATA;
+
+   n_chan = max_chan + 1;
+   n_t_native = max_dtime + 1;
+   n_im = 1;
+   data_class = DATA_UINT32;
+
+   return SUCCESS;
+}
+
+/**
+ * Add the photons from one frame to hist
+ */
+void PTUReader::HistogramFrame(int frame, uint32_t* hist)
+{
+   uint64_t start = frame_start[frame];
+   uint64_t end   = (frame + 1 < (int) frame_start.size()) ? frame_start[frame+1] : n_records;
+
+   int n_t = GetNumTimebins();
+   double px_per_sync = n_x / line_duration;
+
+   uint64_t ofl = 0, sync = 0;
+   int chan, dtime;
+
+   int y = -1;
+   bool in_line = false;
+   uint64_t line_start = 0;
+
+   for(uint64_t i=start; i<end; i++)
+   {
+      int ev = DecodeRecord(records[i], ofl, sync, chan, dtime);
+
+      if (ev == EVENT_MARKER)
+      {
+         if (chan & line_start_mask)
+         {
+            y++;
+            line_start = sync;
+            in_line = true;
+         }
+         if (chan & line_stop_mask)
+            in_line = false;
+      }
+      else if (ev == EVENT_PHOTON && in_line && y < n_y && chan >= 0 && chan < n_chan)
+      {
+         int x = (int) ((sync - line_start) * px_per_sync);
+         int bin = dtime / time_div;
+         if (x < n_x && bin < n_t)
+            hist[((y * n_x + x) * n_chan + chan) * n_t + bin]++;
+      }
+   }
+}
+
+/**
+ * Accumulate all frames into the image. Frames are independent so are 
+ * histogrammed in parallel, each thread into its own buffer
+ */
+int PTUReader::ReadImage(int im, void* data)
+{
+   if (im != 0)
+      return ERR_INVALID_INPUT;
+
+   size_t n_p = (size_t) n_x * n_y * n_chan * GetNumTimebins();
+   uint32_t* hist = (uint32_t*) data;
+
+   int n_frame = (int) frame_start.size();
+   int n_hist_thread = std::min(n_thread, n_frame);
+
+   memset(hist, 0, n_p * sizeof(uint32_t));
+
+   std::vector< std::vector<uint32_t> > thread_hist(n_hist_thread - 1);
+
+   #pragma omp parallel num_threads(n_hist_thread)
+   {
+      int thread = omp_get_thread_num();
+      uint32_t* h = hist;
+      if (thread > 0)
+      {
+         thread_hist[thread-1].assign(n_p, 0);
+         h = &thread_hist[thread-1][0];
+      }
+
+      #pragma omp for schedule(dynamic, 1)
+      for(int f=0; f<n_frame; f++)
+         HistogramFrame(f, h);
+   }
+
+   for(int i=0; i<n_hist_thread-1; i++)
+      for(size_t j=0; j<n_p; j++)
+         hist[j] += thread_hist[i][j];
+
+   return SUCCESS;
+}
@@ -0,0 +1,79 @@
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+#ifndef _PTUREADER_H
+#define _PTUREADER_H
+
+#include "FLIMReader.h"
+
+/**
+ * Reader for PicoQuant T3 mode TTTR files, either .ptu (tagged header) or 
+ * legacy PicoHarp .pt3. Images are reconstructed from the line and frame 
+ * markers, with all frames accumulated into a single image. 
+ */
+class PTUReader : public FLIMReader
+{
+public:
+
+   PTUReader();
+
+   int ReadImage(int im, void* data);
+
+protected:
+
+   int ReadHeader();
+
+private:
+
+   int ReadPTUHeader();
+   int ReadPT3Header();
+   int IndexRecords();
+
+   void HistogramFrame(int frame, uint32_t* hist);
+
+   enum RecordEvent { EVENT_NONE, EVENT_PHOTON, EVENT_MARKER };
+
+   inline int DecodeRecord(uint32_t rec, uint64_t& ofl, uint64_t& sync, int& chan, int& dtime);
+
+   int rec_type;
+   const uint32_t* records;
+   uint64_t n_records;
+
+   int line_start_mask;
+   int line_stop_mask;
+   int frame_mask;
+
+   // Duration of each line in sync periods, measured from the first line
+   double line_duration;
+
+   // Index of the first record of each frame
+   std::vector<uint64_t> frame_start;
+};
+
+#endif
@@ -0,0 +1,289 @@
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+#include "SDTReader.h"
+#include "FlagDefinitions.h"
+
+#include <cstring>
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+// Offsets into the B&H file header
+#define SDT_DATA_BLOCK_OFFS       14
+#define SDT_NO_OF_DATA_BLOCKS     18
+#define SDT_MEAS_DESC_BLOCK_OFFS  24
+#define SDT_RESERVED1             34
+#define SDT_FILE_HEADER_SIZE      42
+
+// Offsets into the measurement description block
+#define SDT_MEAS_TAC_R   68
+#define SDT_MEAS_TAC_G   72
+#define SDT_MEAS_ADC_RE  86
+#define SDT_MEAS_SCAN_X  175
+#define SDT_MEAS_SCAN_Y  179
+#define SDT_MEAS_SIZE    183
+
+// Offsets into each data block header
+#define SDT_BLOCK_DATA_OFFS    2
+#define SDT_BLOCK_NEXT_OFFS    6
+#define SDT_BLOCK_TYPE         10
+#define SDT_BLOCK_LENGTH       18
+#define SDT_BLOCK_HEADER_SIZE  22
+
+#define SDT_BLOCK_ZIPPED       0x1000
+#define SDT_BLOCK_DTYPE_MASK   0x0F00
+#define SDT_BLOCK_DTYPE_U16    0x0000
+#define SDT_BLOCK_DTYPE_U32    0x0100
+
+namespace
+{
+   template <typename T>
+   T Get(const char* ptr, size_t offset)
+   {
+      T v;
+      memcpy(&v, ptr + offset, sizeof(T));
+      return v;
+   }
+}
+
+int SDTReader::ReadHeader()
+{
+   if (file_size < SDT_FILE_HEADER_SIZE)
+      return ERR_FAILED_TO_MAP_DATA;
+
+   uint32_t data_block_offs = Get<uint32_t>(file_ptr, SDT_DATA_BLOCK_OFFS);
+   uint32_t meas_desc_offs  = Get<uint32_t>(file_ptr, SDT_MEAS_DESC_BLOCK_OFFS);
+   int n_block = Get<uint16_t>(file_ptr, SDT_NO_OF_DATA_BLOCKS);
+   if (n_block == 0x7FFF)
+      n_block = Get<uint32_t>(file_ptr, SDT_RESERVED1);
+
+   if (n_block <= 0 || meas_desc_offs + SDT_MEAS_SIZE > file_size)
+      return ERR_FAILED_TO_MAP_DATA;
+
+   // Get the image dimensions and timing from the first measurement block
+   const char* meas = file_ptr + meas_desc_offs;
+   float tac_r  = Get<float>(meas, SDT_MEAS_TAC_R);
+   int   tac_g  = Get<int16_t>(meas, SDT_MEAS_TAC_G);
+   int   adc_re = Get<int16_t>(meas, SDT_MEAS_ADC_RE);
+   int   scan_x = Get<int32_t>(meas, SDT_MEAS_SCAN_X);
+   int   scan_y = Get<int32_t>(meas, SDT_MEAS_SCAN_Y);
+
+   if (adc_re <= 0)
+      return ERR_FAILED_TO_MAP_DATA;
+   if (tac_g <= 0)
+      tac_g = 1;
+
+   n_t_native = adc_re;
+   dt = tac_r / (tac_g * adc_re) * 1e12;
+
+   // Walk the chain of data blocks
+   uint64_t block_offs = data_block_offs;
+   int block_dtype = -1;
+   for(int i=0; i<n_block; i++)
+   {
+      if (block_offs + SDT_BLOCK_HEADER_SIZE > file_size)
+         return ERR_FAILED_TO_MAP_DATA;
+
+      const char* bh = file_ptr + block_offs;
+      uint32_t data_offs  = Get<uint32_t>(bh, SDT_BLOCK_DATA_OFFS);
+      uint32_t next_offs  = Get<uint32_t>(bh, SDT_BLOCK_NEXT_OFFS);
+      uint16_t block_type = Get<uint16_t>(bh, SDT_BLOCK_TYPE);
+      uint32_t length     = Get<uint32_t>(bh, SDT_BLOCK_LENGTH);
+
+      bool zipped = (block_type & SDT_BLOCK_ZIPPED) != 0;
+      
+      // For zipped blocks the data runs up to the next block 
+      uint64_t data_end = (uint64_t) data_offs + length;
+      if (zipped)
+      {
+         data_end = (i < n_block-1) ? next_offs : file_size;
+         if (data_end <= data_offs)
+            return ERR_FAILED_TO_MAP_DATA;
+      }
+
+      if (data_offs > file_size || data_end > file_size)
+         return ERR_FAILED_TO_MAP_DATA;
+
+      uint64_t stored_size = data_end - data_offs;
+
+      int dtype = block_type & SDT_BLOCK_DTYPE_MASK;
+      if (dtype != SDT_BLOCK_DTYPE_U16 && dtype != SDT_BLOCK_DTYPE_U32)
+         return ERR_INVALID_INPUT;
+      if (block_dtype >= 0 && dtype != block_dtype)
+         return ERR_INVALID_INPUT;
+      block_dtype = dtype;
+
+#ifndef USE_ZLIB
+      if (zipped)
+         return ERR_INVALID_INPUT;
+#endif
+
+      block_data_offset.push_back(data_offs);
+      block_data_size.push_back(stored_size);
+      block_zipped.push_back(zipped);
+
+      if (i == 0)
+      {
+         data_class = (dtype == SDT_BLOCK_DTYPE_U32) ? DATA_UINT32 : DATA_UINT16;
+         size_t value_size = (dtype == SDT_BLOCK_DTYPE_U32) ? sizeof(uint32_t) : sizeof(uint16_t);
+         size_t n_decay = length / (value_size * adc_re);
+
+         // Each routing channel is stored as a complete image. Without scan 
+         // dimensions (a single point measurement) treat the block as a line 
+         // of decays; anything else we can't interpret
+         if (scan_x > 0 && scan_y > 0)
+         {
+            size_t n_scan_px = (size_t) scan_x * scan_y;
+            if (n_decay == 0 || n_decay % n_scan_px != 0)
+               return ERR_INVALID_INPUT;
+
+            n_x = scan_x;
+            n_y = scan_y;
+            n_chan = (int) (n_decay / n_scan_px);
+         }
+         else
+         {
+            n_x = (int) n_decay;
+            n_y = 1;
+            n_chan = 1;
+         }
+
+         image_bytes = (size_t) n_x * n_y * n_chan * adc_re * value_size;
+         if (image_bytes == 0)
+            return ERR_FAILED_TO_MAP_DATA;
+      }
+      else if (!zipped && length < image_bytes)
+      {
+         return ERR_FAILED_TO_MAP_DATA;
+      }
+
+      block_offs = next_offs;
+   }
+
+   n_im = n_block;
+
+   return SUCCESS;
+}
+
+/**
+ * Read the block for image im. Blocks hold each channel in turn, 
+ * [chan][y][x][t], so with more than one channel they're reordered
+ */
+int SDTReader::ReadImage(int im, void* data)
+{
+   if (im < 0 || im >= n_im)
+      return ERR_INVALID_INPUT;
+
+   const char* src = file_ptr + block_data_offset[im];
+
+   std::vector<char> block_buf;
+   char* block = (char*) data;
+   if (n_chan > 1)
+   {
+      block_buf.resize(image_bytes);
+      block = &block_buf[0];
+   }
+
+   if (block_zipped[im])
+   {
+      int err = InflateBlock(src, block_data_size[im], block, image_bytes);
+      if (err != SUCCESS)
+         return err;
+   }
+   else
+   {
+      memcpy(block, src, image_bytes);
+   }
+
+   if (n_chan > 1)
+   {
+      size_t n_px = (size_t) n_x * n_y;
+      size_t decay_bytes = image_bytes / (n_px * n_chan);
+      char* dest = (char*) data;
+
+      for(size_t p=0; p<n_px; p++)
+         for(int c=0; c<n_chan; c++)
+            memcpy(dest + (p * n_chan + c) * decay_bytes, block + (c * n_px + p) * decay_bytes, decay_bytes);
+   }
+
+   return SUCCESS;
+}
+
+/**
+ * Zipped blocks are stored as a zip archive containing a single 
+ * deflated file; skip the local file header and inflate the contents
+ */
+int SDTReader::InflateBlock(const char* src, size_t src_size, void* data, size_t size)
+{
+#ifdef USE_ZLIB
+   const size_t zip_header_size = 30;
+
+   if (src_size < zip_header_size || Get<uint32_t>(src, 0) != 0x04034b50)
+      return ERR_FAILED_TO_MAP_DATA;
+
+   uint16_t method    = Get<uint16_t>(src, 8);
+   uint16_t name_len  = Get<uint16_t>(src, 26);
+   uint16_t extra_len = Get<uint16_t>(src, 28);
+
+   size_t start = zip_header_size + name_len + extra_len;
+   if (start > src_size)
+      return ERR_FAILED_TO_MAP_DATA;
+
+   if (method == 0)
+   {
+      if (src_size - start < size)
+         return ERR_FAILED_TO_MAP_DATA;
+      memcpy(data, src + start, size);
+      return SUCCESS;
+   }
+
+   z_stream strm;
+   memset(&strm, 0, sizeof(strm));
+   if (inflateInit2(&strm, -MAX_WBITS) != Z_OK)
+      return ERR_OUT_OF_MEMORY;
+
+   strm.next_in   = (Bytef*) (src + start);
+   strm.avail_in  = (uInt) (src_size - start);
+   strm.next_out  = (Bytef*) data;
+   strm.avail_out = (uInt) size;
+
+   int ret = inflate(&strm, Z_FINISH);
+   size_t n_out = size - strm.avail_out;
+   inflateEnd(&strm);
+
+   if ((ret != Z_STREAM_END && ret != Z_BUF_ERROR) || n_out < size)
+      return ERR_FAILED_TO_MAP_DATA;
+
+   return SUCCESS;
+#else
+   return ERR_INVALID_INPUT;
+#endif
+}
@@ -0,0 +1,61 @@
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+#ifndef _SDTREADER_H
+#define _SDTREADER_H
+
+#include "FLIMReader.h"
+
+/**
+ * Reader for Becker & Hickl .sdt files. Each data block in the file is
+ * treated as one image, with a channel for each routing channel it holds. 
+ * Blocks may be stored raw or zip compressed (the latter requires zlib)
+ */
+class SDTReader : public FLIMReader
+{
+public:
+
+   int ReadImage(int im, void* data);
+
+protected:
+
+   int ReadHeader();
+
+private:
+
+   int InflateBlock(const char* src, size_t src_size, void* data, size_t size);
+
+   std::vector<uint64_t> block_data_offset;
+   std::vector<uint64_t> block_data_size;
+   std::vector<bool>     block_zipped;
+
+   size_t image_bytes;
+};
+
+#endif
@@ -0,0 +1,331 @@
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+#include "CompressedData.h"
+#include "FlagDefinitions.h"
+#include "DataTypes.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+   inline void PutVarint(std::vector<uint8_t>& buf, uint64_t v)
+   {
+      while (v >= 0x80)
+      {
+         buf.push_back((uint8_t) (v | 0x80));
+         v >>= 7;
+      }
+      buf.push_back((uint8_t) v);
+   }
+
+   /**
+    * Read a varint, returning false if the data ends before it does
+    */
+   inline bool GetVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v)
+   {
+      v = 0;
+      int shift = 0;
+      while (p < end && shift < 64)
+      {
+         uint8_t b = *(p++);
+         v |= ((uint64_t) (b & 0x7F)) << shift;
+         if (!(b & 0x80))
+            return true;
+         shift += 7;
+      }
+      return false;
+   }
+
+   inline uint64_t ZigZag(int64_t v)
+   {
+      return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+   }
+
+   inline int64_t UnZigZag(uint64_t v)
+   {
+      return (int64_t) (v >> 1) ^ -((int64_t) (v & 1));
+   }
+
+   int64_t GetValue(const void* data, int data_class, size_t i)
+   {
+      if (data_class == DATA_UINT16)
+         return ((const uint16_t*) data)[i];
+      else if (data_class == DATA_UINT32)
+         return ((const uint32_t*) data)[i];
+      else if (data_class == DATA_UINT8)
+         return ((const uint8_t*) data)[i];
+      else if (data_class == DATA_FLOAT16)
+         return ((const float16*) data)[i].bits;
+      else
+         return (int64_t) ((const float*) data)[i];
+   }
+}
+
+CompressedData::CompressedData()
+{
+   Close();
+}
+
+bool CompressedData::IsCompressedData(const char* ptr, size_t size)
+{
+   return size >= sizeof(CompressedDataHeader) && memcmp(ptr, COMPRESSED_DATA_MAGIC, 8) == 0;
+}
+
+/**
+ * Attach to a container held in memory (usually a mapped file). The memory
+ * must remain valid until Close is called
+ */
+int CompressedData::Open(const char* ptr, size_t size)
+{
+   Close();
+
+   if (!IsCompressedData(ptr, size))
+      return ERR_FAILED_TO_MAP_DATA;
+
+   CompressedDataHeader h;
+   memcpy(&h, ptr, sizeof(h));
+
+   if (h.block_px == 0 || h.n_px == 0 || h.data_class > DATA_FLOAT16 || h.codec > CODEC_DELTA_VARINT)
+      return ERR_FAILED_TO_MAP_DATA;
+
+   int n_block_im = (h.n_px + h.block_px - 1) / h.block_px;
+   uint64_t n_block = (uint64_t) n_block_im * h.n_im;
+   
+   if (sizeof(h) + (n_block + 1) * sizeof(uint64_t) > size)
+      return ERR_FAILED_TO_MAP_DATA;
+
+   // Blocks must follow the index, in order, and end within the file
+   const uint64_t* offset = (const uint64_t*) (ptr + sizeof(h));
+   if (offset[0] < sizeof(h) + (n_block + 1) * sizeof(uint64_t) || offset[n_block] > size)
+      return ERR_FAILED_TO_MAP_DATA;
+
+   for(uint64_t i=0; i<n_block; i++)
+      if (offset[i] > offset[i+1])
+         return ERR_FAILED_TO_MAP_DATA;
+
+   header = h;
+   base = ptr;
+   block_offset = offset;
+   n_block_per_im = n_block_im;
+
+   return SUCCESS;
+}
+
+void CompressedData::Close()
+{
+   memset(&header, 0, sizeof(header));
+   base = NULL;
+   block_offset = NULL;
+   n_block_per_im = 0;
+}
+
+/**
+ * Decode a block of n_px_block pixels, returning an error if the block 
+ * ends before all of their values
+ */
+template <typename T>
+int CompressedData::DecodeBlock(const uint8_t* src, const uint8_t* src_end, T* dest, int n_px_block) const
+{
+   int n_meas = header.n_meas;
+
+   if (header.codec == CODEC_RAW)
+   {
+      size_t block_size = (size_t) n_px_block * n_meas * sizeof(T);
+      if ((size_t) (src_end - src) < block_size)
+         return ERR_FAILED_TO_MAP_DATA;
+
+      memcpy(dest, src, block_size);
+      return SUCCESS;
+   }
+
+   for(int p=0; p<n_px_block; p++)
+   {
+      int64_t v = 0;
+      for(int i=0; i<n_meas; i++)
+      {
+         uint64_t d;
+         if (!GetVarint(src, src_end, d))
+            return ERR_FAILED_TO_MAP_DATA;
+         v += UnZigZag(d);
+         dest[i] = (T) v;
+      }
+      dest += n_meas;
+   }
+
+   return SUCCESS;
+}
+
+/**
+ * Decode an image into data, which must have space for n_px * n_meas 
+ * values of the container's data class. If a pixel range is given only
+ * the blocks covering it are decoded. Returns an error if a block is 
+ * truncated. Safe to call from several threads
+ */
+int CompressedData::DecodeImage(int im, void* data, int px_begin, int px_end) const
+{
+   if (base == NULL || im < 0 || im >= (int) header.n_im)
+      return ERR_FAILED_TO_MAP_DATA;
+
+   if (px_end < 0)
+      px_end = header.n_px;
+
+   // Only decode the blocks overlapping [px_begin, px_end)
+   int block_px = (int) header.block_px;
+   int b_begin = std::max(px_begin, 0) / block_px;
+   int b_end = std::min((px_end + block_px - 1) / block_px, n_block_per_im);
+
+   for(int b=b_begin; b<b_end; b++)
+   {
+      uint64_t idx = (uint64_t) im * n_block_per_im + b;
+      const uint8_t* src     = (const uint8_t*) base + block_offset[idx];
+      const uint8_t* src_end = (const uint8_t*) base + block_offset[idx+1];
+
+      int px0 = b * header.block_px;
+      int n_px_block = std::min((int) header.block_px, (int) header.n_px - px0);
+      size_t offset = (size_t) px0 * header.n_meas;
+
+      int err;
+      if (header.data_class == DATA_UINT16)
+         err = DecodeBlock(src, src_end, (uint16_t*) data + offset, n_px_block);
+      else if (header.data_class == DATA_UINT32)
+         err = DecodeBlock(src, src_end, (uint32_t*) data + offset, n_px_block);
+      else if (header.data_class == DATA_UINT8)
+         err = DecodeBlock(src, src_end, (uint8_t*) data + offset, n_px_block);
+      else if (header.data_class == DATA_FLOAT16) // delta coded as raw bits
+         err = DecodeBlock(src, src_end, (uint16_t*) data + offset, n_px_block);
+      else
+         err = DecodeBlock(src, src_end, (float*) data + offset, n_px_block);
+
+      if (err != SUCCESS)
+         return err;
+   }
+
+   return SUCCESS;
+}
+
+/**
+ * Write a dense data cube (n_im x n_px x n_meas) to a container file. 
+ * Integer and half precision data (and float data containing only integers)
+ * is delta+varint encoded, anything else is stored raw
+ */
+int CompressedData::Write(const char* filename, const void* data, int data_class, int n_im, int n_px, int n_meas, int block_px)
+{
+   if (data == NULL || n_im <= 0 || n_px <= 0 || n_meas <= 0 || data_class < DATA_FLOAT || data_class > DATA_FLOAT16)
+      return ERR_INVALID_INPUT;
+
+   if (block_px <= 0)
+      block_px = n_px;
+
+   size_t n_total = (size_t) n_im * n_px * n_meas;
+
+   CompressedDataHeader h;
+   memcpy(h.magic, COMPRESSED_DATA_MAGIC, 8);
+   h.data_class = data_class;
+   h.codec      = CODEC_DELTA_VARINT;
+   h.n_im       = n_im;
+   h.n_px       = n_px;
+   h.n_meas     = n_meas;
+   h.block_px   = block_px;
+
+   if (data_class == DATA_FLOAT)
+   {
+      const float* f = (const float*) data;
+      for(size_t i=0; i<n_total; i++)
+      {
+         if (f[i] != floor(f[i]) || fabs(f[i]) > 2147483647.0f)
+         {
+            h.codec = CODEC_RAW;
+            break;
+         }
+      }
+   }
+
+   FILE* fp = fopen(filename, "wb");
+   if (fp == NULL)
+      return ERR_COULD_NOT_OPEN_MAPPED_FILE;
+
+   int n_block_im = (n_px + block_px - 1) / block_px;
+   uint64_t n_block = (uint64_t) n_block_im * n_im;
+   
+   std::vector<uint64_t> offset(n_block + 1);
+   offset[0] = sizeof(h) + (n_block + 1) * sizeof(uint64_t);
+
+   // Leave space for the index, we'll fill it in at the end
+   fwrite(&h, sizeof(h), 1, fp);
+   fwrite(&offset[0], sizeof(uint64_t), n_block + 1, fp);
+
+   std::vector<uint8_t> buf;
+   int value_size = DataClassSize(data_class);
+
+   for(uint64_t idx=0; idx<n_block; idx++)
+   {
+      int im = (int) (idx / n_block_im);
+      int px0 = (int) (idx % n_block_im) * block_px;
+      int n_px_block = std::min(block_px, n_px - px0);
+      size_t start = ((size_t) im * n_px + px0) * n_meas;
+
+      buf.clear();
+
+      if (h.codec == CODEC_RAW)
+      {
+         const uint8_t* src = (const uint8_t*) data + start * value_size;
+         buf.assign(src, src + (size_t) n_px_block * n_meas * value_size);
+      }
+      else
+      {
+         for(int p=0; p<n_px_block; p++)
+         {
+            int64_t last = 0;
+            for(int i=0; i<n_meas; i++)
+            {
+               int64_t v = GetValue(data, data_class, start + (size_t) p * n_meas + i);
+               PutVarint(buf, ZigZag(v - last));
+               last = v;
+            }
+         }
+      }
+
+      if (!buf.empty())
+         fwrite(&buf[0], 1, buf.size(), fp);
+      offset[idx+1] = offset[idx] + buf.size();
+   }
+
+   fseek(fp, sizeof(h), SEEK_SET);
+   fwrite(&offset[0], sizeof(uint64_t), n_block + 1, fp);
+
+   int err = ferror(fp) ? ERR_COULD_NOT_OPEN_MAPPED_FILE : SUCCESS;
+   fclose(fp);
+
+   return err;
+}
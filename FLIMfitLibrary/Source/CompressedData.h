@@ -0,0 +1,98 @@
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+#ifndef _COMPRESSEDDATA_H
+#define _COMPRESSEDDATA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+   Chunked container for FLIM data. Each image is split into blocks of 
+   block_px pixels, each of which is compressed independently so that 
+   images can be decoded in any order and by several threads at once.
+
+   Layout (little endian):
+      CompressedDataHeader
+      uint64_t block_offset[n_block+1]   offsets from the start of the header
+      block data
+
+   With CODEC_DELTA_VARINT each decay is stored as the differences between
+   successive bins, zigzag encoded as LEB128 varints. Float data is only 
+   stored this way if every value is an integer; otherwise CODEC_RAW is used.
+*/
+
+#define COMPRESSED_DATA_MAGIC "FLIMDZ01"
+
+#define CODEC_RAW          0
+#define CODEC_DELTA_VARINT 1
+
+struct CompressedDataHeader
+{
+   char     magic[8];
+   uint32_t data_class;
+   uint32_t codec;
+   uint32_t n_im;
+   uint32_t n_px;
+   uint32_t n_meas;
+   uint32_t block_px;
+};
+
+class CompressedData
+{
+public:
+
+   CompressedData();
+
+   static bool IsCompressedData(const char* ptr, size_t size);
+
+   int Open(const char* ptr, size_t size);
+   void Close();
+
+   int DecodeImage(int im, void* data, int px_begin = 0, int px_end = -1) const;
+
+   int GetDataClass() const { return header.data_class; }
+   int GetNumImages() const { return header.n_im; }
+   int GetNumPixels() const { return header.n_px; }
+   int GetNumMeas()   const { return header.n_meas; }
+
+   static int Write(const char* filename, const void* data, int data_class, int n_im, int n_px, int n_meas, int block_px);
+
+private:
+
+   template <typename T>
+   int DecodeBlock(const uint8_t* src, const uint8_t* src_end, T* dest, int n_px_block) const;
+
+   CompressedDataHeader header;
+   const char* base;
+   const uint64_t* block_offset;
+   int n_block_per_im;
+};
+
+#endif
@@ -0,0 +1,241 @@
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+
+#include "DataIndex.h"
+#include "FlagDefinitions.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <atomic>
+#include <exception>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+DataIndex::DataIndex()
+{
+   base = NULL;
+   size = 0;
+   writable = false;
+   valid = NULL;
+   data_offset = 0;
+   n_px = 0;
+}
+
+size_t DataIndex::DataOffset(size_t n_key, int n_im)
+{
+   size_t valid_size = ((size_t) n_im + 7) / 8 * 8;
+   return sizeof(DataIndexHeader) + n_key * sizeof(uint64_t) + valid_size;
+}
+
+/**
+ * Open the index for data described by key, creating a new index if there 
+ * isn't a matching one. If the index can't be written (e.g. the data is on 
+ * a read only share) an existing index is still used for reading
+ */
+int DataIndex::Open(const char* filename, const std::vector<uint64_t>& key, int n_im, int n_px)
+{
+   Close();
+
+   if (Map(filename, true) == SUCCESS && Matches(key, n_im, n_px))
+      return SUCCESS;
+
+   Close();
+
+   if (Create(filename, key, n_im, n_px) == SUCCESS && Map(filename, true) == SUCCESS && Matches(key, n_im, n_px))
+      return SUCCESS;
+
+   Close();
+
+   if (Map(filename, false) == SUCCESS && Matches(key, n_im, n_px))
+      return SUCCESS;
+
+   Close();
+   return ERR_COULD_NOT_OPEN_MAPPED_FILE;
+}
+
+void DataIndex::Close()
+{
+   map_region = boost::interprocess::mapped_region();
+   map_file = boost::interprocess::file_mapping();
+   base = NULL;
+   size = 0;
+   writable = false;
+   valid = NULL;
+}
+
+int DataIndex::Map(const char* filename, bool read_write)
+{
+   boost::interprocess::mode_t mode = read_write ? boost::interprocess::read_write : boost::interprocess::read_only;
+
+   try
+   {
+      map_file = boost::interprocess::file_mapping(filename, mode);
+      map_region = boost::interprocess::mapped_region(map_file, mode);
+   }
+   catch(std::exception& e)
+   {
+      e = e;
+      return ERR_COULD_NOT_OPEN_MAPPED_FILE;
+   }
+
+   base = (char*) map_region.get_address();
+   size = map_region.get_size();
+   writable = read_write;
+
+   return SUCCESS;
+}
+
+bool DataIndex::Matches(const std::vector<uint64_t>& key, int n_im, int n_px)
+{
+   if (size < sizeof(DataIndexHeader))
+      return false;
+
+   const DataIndexHeader* h = (const DataIndexHeader*) base;
+
+   if (memcmp(h->magic, DATA_INDEX_MAGIC, 8) != 0 || h->n_im != (uint32_t) n_im || 
+       h->n_px != (uint32_t) n_px || h->n_key != key.size())
+      return false;
+
+   size_t offset = DataOffset(key.size(), n_im);
+   if (size != offset + (size_t) n_im * 2 * n_px * sizeof(double))
+      return false;
+
+   if (!key.empty() && memcmp(base + sizeof(DataIndexHeader), &key[0], key.size() * sizeof(uint64_t)) != 0)
+      return false;
+
+   this->n_px = n_px;
+   data_offset = offset;
+   valid = (uint8_t*) (base + sizeof(DataIndexHeader) + key.size() * sizeof(uint64_t));
+
+   return true;
+}
+
+/**
+ * 64 bit FNV-1a hash of a key, used to give indexes for different data 
+ * parameters different names
+ */
+uint64_t DataIndex::HashKey(const uint64_t* key, size_t n_key)
+{
+   uint64_t hash = 14695981039346656037ULL;
+   const uint8_t* bytes = (const uint8_t*) key;
+   for(size_t i=0; i<n_key * sizeof(uint64_t); i++)
+   {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+   }
+   return hash;
+}
+
+/**
+ * Write an empty index, with no valid images, sized to hold every image.
+ * The index is written to a temporary file which is then renamed over
+ * filename, so an index another fit has mapped is never truncated
+ */
+int DataIndex::Create(const char* filename, const std::vector<uint64_t>& key, int n_im, int n_px)
+{
+   static std::atomic<int> n_created(0);
+
+   std::string tmp_filename = std::string(filename) + "." + std::to_string((long long) getpid()) + 
+                              "." + std::to_string(n_created++) + ".tmp";
+
+   DataIndexHeader h;
+   memcpy(h.magic, DATA_INDEX_MAGIC, 8);
+   h.n_im = n_im;
+   h.n_px = n_px;
+   h.n_key = (uint32_t) key.size();
+   h.reserved = 0;
+
+   FILE* fp = fopen(tmp_filename.c_str(), "wb");
+   if (fp == NULL)
+      return ERR_COULD_NOT_OPEN_MAPPED_FILE;
+
+   std::vector<uint8_t> valid(DataOffset(key.size(), n_im) - sizeof(h) - key.size() * sizeof(uint64_t), 0);
+
+   fwrite(&h, sizeof(h), 1, fp);
+   if (!key.empty())
+      fwrite(&key[0], sizeof(uint64_t), key.size(), fp);
+   if (!valid.empty())
+      fwrite(&valid[0], 1, valid.size(), fp);
+
+   // Extend the file to its full size; the image data is filled in as it's scanned
+   long long data_size = (long long) n_im * 2 * n_px * sizeof(double);
+   if (data_size > 0)
+   {
+#ifdef _WIN32
+      _fseeki64(fp, data_size - 1, SEEK_CUR);
+#else
+      fseeko(fp, data_size - 1, SEEK_CUR);
+#endif
+      fputc(0, fp);
+   }
+
+   int err = ferror(fp) ? ERR_COULD_NOT_OPEN_MAPPED_FILE : SUCCESS;
+   fclose(fp);
+
+   if (err == SUCCESS)
+   {
+#ifdef _WIN32
+      // Fails if the old index is mapped, in which case we leave it be
+      bool renamed = MoveFileExA(tmp_filename.c_str(), filename, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+      bool renamed = rename(tmp_filename.c_str(), filename) == 0;
+#endif
+      if (!renamed)
+         err = ERR_COULD_NOT_OPEN_MAPPED_FILE;
+   }
+
+   if (err != SUCCESS)
+      remove(tmp_filename.c_str());
+
+   return err;
+}
+
+/**
+ * Store the scan of an image. The image is only marked valid once its data
+ * has been written, so an interrupted scan leaves the image to be rescanned
+ */
+void DataIndex::SetImage(int im, const double* intensity, const double* peak)
+{
+   if (!writable)
+      return;
+
+   double* ptr = ImagePtr(im);
+   memcpy(ptr, intensity, n_px * sizeof(double));
+   memcpy(ptr + n_px, peak, n_px * sizeof(double));
+
+   valid[im] = 1;
+}
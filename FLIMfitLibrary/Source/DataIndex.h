@@ -0,0 +1,110 @@
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+
+#ifndef _DATAINDEX_H
+#define _DATAINDEX_H
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/*
+   Sidecar index kept next to a data file so that the intensity scan can be
+   skipped when the same data is reopened. For each image we store the 
+   integrated intensity and peak value of every pixel, from which the 
+   threshold, saturation and region masks can be recalculated for any
+   fitting parameters without reading the data.
+
+   The index is only valid for data matching its key, which describes the
+   size and modification time of the data files and the data parameters.
+   An index which doesn't match is replaced by renaming a new index over
+   it, never rewritten in place, as other fits may have it mapped.
+
+   Layout (little endian):
+      DataIndexHeader
+      uint64_t key[n_key]
+      uint8_t  valid[n_im]         padded to a multiple of 8 bytes
+      double   intensity[n_px], peak[n_px] for each image
+*/
+
+#define DATA_INDEX_MAGIC "FLIMIX02"
+
+struct DataIndexHeader
+{
+   char     magic[8];
+   uint32_t n_im;
+   uint32_t n_px;
+   uint32_t n_key;
+   uint32_t reserved;
+};
+
+class DataIndex
+{
+public:
+
+   DataIndex();
+
+   int Open(const char* filename, const std::vector<uint64_t>& key, int n_im, int n_px);
+   void Close();
+
+   static uint64_t HashKey(const uint64_t* key, size_t n_key);
+
+   bool IsOpen() const { return base != NULL; }
+   bool IsWritable() const { return writable; }
+
+   bool HasImage(int im) const { return valid[im] != 0; }
+   const double* GetIntensity(int im) const { return ImagePtr(im); }
+   const double* GetPeak(int im) const { return ImagePtr(im) + n_px; }
+
+   void SetImage(int im, const double* intensity, const double* peak);
+
+private:
+
+   double* ImagePtr(int im) const { return (double*) (base + data_offset) + (size_t) im * 2 * n_px; }
+
+   int Map(const char* filename, bool read_write);
+   bool Matches(const std::vector<uint64_t>& key, int n_im, int n_px);
+   static int Create(const char* filename, const std::vector<uint64_t>& key, int n_im, int n_px);
+   static size_t DataOffset(size_t n_key, int n_im);
+
+   boost::interprocess::file_mapping map_file;
+   boost::interprocess::mapped_region map_region;
+   char* base;
+   size_t size;
+   bool writable;
+
+   uint8_t* valid;
+   size_t data_offset;
+   int n_px;
+};
+
+#endif
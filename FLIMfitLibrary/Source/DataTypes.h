@@ -0,0 +1,137 @@
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+#ifndef _DATATYPES_H
+#define _DATATYPES_H
+
+#include "FlagDefinitions.h"
+#include <stdint.h>
+#include <cstring>
+
+/**
+ * Convert an IEEE 754 half precision value to float
+ */
+inline float HalfToFloat(uint16_t h)
+{
+   uint32_t sign = (uint32_t) (h & 0x8000) << 16;
+   uint32_t exp  = (h >> 10) & 0x1F;
+   uint32_t mant = h & 0x3FF;
+   uint32_t bits;
+
+   if (exp == 0x1F)       // inf or nan
+      bits = sign | 0x7F800000 | (mant << 13);
+   else if (exp != 0)     // normal
+      bits = sign | ((exp + 112) << 23) | (mant << 13);
+   else if (mant == 0)    // zero
+      bits = sign;
+   else                   // subnormal, normalise
+   {
+      uint32_t e = 113;
+      while (!(mant & 0x400))
+      {
+         mant <<= 1;
+         e--;
+      }
+      bits = sign | (e << 23) | ((mant & 0x3FF) << 13);
+   }
+
+   float f;
+   memcpy(&f, &bits, sizeof(f));
+   return f;
+}
+
+/**
+ * Convert a float to IEEE 754 half precision, rounding to nearest even
+ */
+inline uint16_t FloatToHalf(float f)
+{
+   uint32_t x;
+   memcpy(&x, &f, sizeof(x));
+
+   uint16_t sign = (uint16_t) ((x >> 16) & 0x8000);
+   uint32_t a = x & 0x7FFFFFFF;
+
+   if (a >= 0x7F800000)   // inf or nan
+      return sign | 0x7C00 | ((a > 0x7F800000) ? 0x200 : 0);
+   if (a >= 0x477FF000)   // rounds to inf
+      return sign | 0x7C00;
+   if (a < 0x33000000)    // rounds to zero
+      return sign;
+
+   uint32_t r, rem, halfway;
+   if (a < 0x38800000)    // subnormal
+   {
+      uint32_t shift = 126 - (a >> 23);
+      uint32_t m = (a & 0x7FFFFF) | 0x800000;
+      r = m >> shift;
+      rem = m & ((1u << shift) - 1);
+      halfway = 1u << (shift - 1);
+   }
+   else
+   {
+      r = (a - 0x38000000) >> 13;
+      rem = a & 0x1FFF;
+      halfway = 0x1000;
+   }
+
+   if (rem > halfway || (rem == halfway && (r & 1)))
+      r++;
+
+   return sign | (uint16_t) r;
+}
+
+/**
+ * Half precision storage type. Arithmetic is done in float
+ */
+class float16
+{
+public:
+   float16() {}
+   float16(float f) : bits(FloatToHalf(f)) {}
+   operator float() const { return HalfToFloat(bits); }
+   float16& operator+=(float v) { bits = FloatToHalf(HalfToFloat(bits) + v); return *this; }
+
+   uint16_t bits;
+};
+
+/**
+ * Size in bytes of one value of a data class
+ */
+inline int DataClassSize(int data_class)
+{
+   switch(data_class)
+   {
+   case DATA_UINT8:   return sizeof(uint8_t);
+   case DATA_UINT16:  return sizeof(uint16_t);
+   case DATA_FLOAT16: return sizeof(float16);
+   default:           return sizeof(float);
+   }
+}
+
+#endif
@@ -1,742 +1,2048 @@
-//=========================================================================
-//
-// Copyright (C) 2013 Imperial College London.
-// All rights reserved.
-//
-// This program is free software; you can redistribute it and/or modify
-// it under the terms of the GNU General Public License as published by
-// the Free Software Foundation; either version 2 of the License, or
-// (at your option) any later version.
-//
-// This program is distributed in the hope that it will be useful,
-// but WITHOUT ANY WARRANTY; without even the implied warranty of
-// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-// GNU General Public License for more details.
-//
-// You should have received a copy of the GNU General Public License along
-// with this program; if not, write to the Free Software Foundation, Inc.,
-// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
-//
-// This software tool was developed with support from the UK 
-// Engineering and Physical Sciences Council 
-// through  a studentship from the Institute of Chemical Biology 
-// and The Wellcome Trust through a grant entitled 
-// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
-//
-// Author : Sean Warren
-//
-//=========================================================================
-
-
-#include "FLIMData.h"
-#include <cmath>
-//#include "hdf5.h"
-
-FLIMData::FLIMData(int polarisation_resolved, double g_factor, int n_im, int n_x, int n_y, int n_chan, int n_t_full, double t[], double t_int[], int t_skip[], int n_t, int data_type, 
-                   int* use_im, mask_type mask[], int merge_regions, int threshold, int limit, double counts_per_photon, int global_mode, int smoothing_factor, int use_autosampling, int n_thread, FitStatus* status) :
-   polarisation_resolved(polarisation_resolved),
-   g_factor(g_factor),
-   n_im(n_im), 
-   n_x(n_x),
-   n_y(n_y),
-   n_chan(n_chan),
-   n_t_full(n_t_full),
-   t(t),
-   t_int(t_int),
-   n_t(n_t),
-   data_type(data_type),
-   mask(mask),
-   merge_regions(merge_regions),
-   threshold(threshold),
-   limit(limit),
-   counts_per_photon(counts_per_photon),
-   smoothing_factor(smoothing_factor),
-   use_autosampling(use_autosampling),
-   n_thread(n_thread),
-   status(status)
-{
-   has_data = false;
-   has_acceptor = false;
-
-   data_file = NULL;
-   acceptor_  = NULL;
-   loader_thread = NULL;
-
-
-   image_t0_shift = NULL;
-
-   // Make sure waiting threads are notified when we terminate
-   status->AddConditionVariable(&data_avail_cond);
-   status->AddConditionVariable(&data_used_cond);
-
-
-   // So that we can calculate errors properly
-   if (global_mode == MODE_PIXELWISE && n_x == 1 && n_y == 1)
-      global_mode = MODE_IMAGEWISE;
-
-   this->global_mode = global_mode;
-
-   stream_data = STREAM_DATA;
-
-   n_masked_px = 0;
-
-   // Make sure we exclude very dim pixels which 
-   // can break the autosampling (we might end up with only one bin!)
-   if (threshold < 3)
-      threshold = 3;
-
-   supplied_mask = (mask != NULL);
-
-   if (!supplied_mask)
-   {
-      int sz_mask = n_im * n_x * n_y;
-      this->mask = new mask_type[sz_mask]; //ok
-      supplied_mask = false;
-      for(int i=0; i<sz_mask; i++)
-         this->mask[i] = 1;
-   }
-
-
-   this->use_im = new int[n_im];
-
-   n_im_used = 0;
-   if (use_im != NULL)
-   {
-      for(int i=0; i<n_im; i++)
-      {
-         if (use_im[i])
-            for(int j=0; j<n_x*n_y; j++)
-               if(this->mask[i*n_x*n_y+j] > 0)
-               {
-                  this->use_im[n_im_used] = i;
-                  n_im_used++;
-                  break;
-               }
-      }
-   }
-   else
-   {
-      n_im_used = n_im;
-   }
-
-   n_meas = n_chan * n_t;
-   n_meas_full = n_chan * n_t_full;
-
-   background_value = 0;
-   background_type = BG_NONE;
-
-   if (n_thread < 1)
-      n_thread = 1;
-
-   n_px = n_x * n_y;
-   n_p  = n_x * n_y * n_meas_full;
-
-   this->t_skip = new int[n_chan]; //ok
-   if (t_skip == NULL)
-   {
-      for(int i=0; i<n_chan; i++)
-         this->t_skip[i] = 0;
-   }
-   else
-   {
-      for(int i=0; i<n_chan; i++)
-         this->t_skip[i] = t_skip[i];
-   }
-
-   tr_data_    = new float[ n_thread * n_p ]; //ok
-   tr_buf_     = new float[ n_thread * n_p ]; //ok
-   intensity_  = new float[ n_thread * n_px ];
-
-   if (polarisation_resolved)
-      r_ss_ = new float[ n_thread * n_px ];
-
-   tr_row_buf_ = new float[ n_thread * (n_x+n_y) ]; //ok
-
-   region_count = new int[ n_im_used * MAX_REGION ];
-   region_pos   = new int[ n_im_used * MAX_REGION ];
-   region_idx   = new int[ (n_im_used+1) * MAX_REGION ];
-   output_region_idx   = new int[ n_im_used * MAX_REGION ];
-
-   for (int i=0; i<n_im_used * MAX_REGION; i++)
-   {
-      region_count[i] = 0;
-      region_pos[i] = 0;
-      region_idx[i] = -1;
-      output_region_idx[i] = -1;
-   }
-   for (int i=0; i<MAX_REGION; i++)
-      region_idx[n_im_used * MAX_REGION + i] = -1;
-   
-   data_map_view = new boost::interprocess::mapped_region[n_thread]; //ok
-
-   cur_transformed = new int[n_thread]; //ok 
-
-   data_used = new int[n_thread];
-   data_loaded = new int[n_thread];
-
-   for (int i=0; i<n_thread; i++)
-   {
-      cur_transformed[i] = -1;
-      data_used[i] = 1;
-      data_loaded[i] = -1;
-   }
-
-   int dim_required = smoothing_factor*2 + 2;
-   if (n_x < dim_required || n_y < dim_required)
-      this->smoothing_factor = 0;
-
-   smoothing_area = (2*this->smoothing_factor+1)*(2*this->smoothing_factor+1);
-
-   resample_idx = new int[n_t * n_thread]; //ok
-   n_meas_res = new int[n_thread]; //ok
-
-   use_ext_resample_idx = 0;
-   ext_resample_idx = NULL;
-   ext_n_meas_res = 0;
-   
-   for(int j=0; j<n_thread; j++)
-   {
-      for(int i=0; i<n_t-1; i++)
-         resample_idx[j*n_t+i] = 1;
-      
-      resample_idx[j*n_t+n_t-1] = 0;
-
-      n_meas_res[j] = n_t * n_chan;
-   }
-
-
-}
-
-
-/**
- * Wrapper function for DataLoaderThread
- */
-void StartDataLoaderThread(void* wparams)
-{
-   DataLoaderThreadParams* params = (DataLoaderThreadParams*) wparams;
-   FLIMData* data = params->data;
-  
-   if (data->data_class == DATA_FLOAT)
-      data->DataLoaderThread<float>(params->only_load_non_empty_images, params->load_region);
-   else if (data->data_class == DATA_UINT32)
-      data->DataLoaderThread<uint32_t>(params->only_load_non_empty_images, params->load_region);
-   else
-      data->DataLoaderThread<uint16_t>(params->only_load_non_empty_images, params->load_region);
-
-   delete params;
-}
-
-void FLIMData::MarkCompleted(int slot)
-{
-   data_mutex.lock();
-   data_loaded[slot] = -1;
-   data_used[slot] = 1;
-   data_mutex.unlock();
-
-   data_used_cond.notify_all();
-}
-
-/*
-{
-
-//===================================================================================//
-
-   #define FILE            "c:\\users\\scw09\\Documents\\h5ex_d_hyper.h5"
-   #define DATASET         "DS1"
-   #define DIM0            6
-   #define DIM1            8
-
-    int rdata[DIM0][DIM1];
-
-    hid_t  file = H5Fopen (FILE, H5F_ACC_RDONLY, H5P_DEFAULT);
-    hid_t  dset = H5Dopen (file, DATASET, H5P_DEFAULT);
-
-    herr_t status = H5Dread (dset, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, rdata[0]);
-
-    hsize_t     dims[2] = {DIM0, DIM1},
-                start[2],
-                stride[2],
-                count[2],
-                block[2];
-
-
-    // Define and select the hyperslab to use for reading.
-
-    hid_t space = H5Dget_space (dset);
-    start[0]  = 0;
-    start[1]  = 1;
-    stride[0] = 4;
-    stride[1] = 4;
-    count[0]  = 2;
-    count[1]  = 2;
-    block[0]  = 2;
-    block[1]  = 3;
-    status = H5Sselect_hyperslab (space, H5S_SELECT_SET, start, stride, count, block);
-
-    // Read the data using the previously defined hyperslab.
-     
-    status = H5Dread (dset, H5T_NATIVE_INT, H5S_ALL, space, H5P_DEFAULT,
-                rdata[0]);
-
-    //===================================================================================//
-
-
-}
-*/
-
-int FLIMData::SetAcceptor(float acceptor[])
-{
-   this->acceptor_ = acceptor;
-   has_acceptor = true;
-
-   return SUCCESS;
-}
-
-int FLIMData::SetData(char* data_file, int data_class, int data_skip)
-{
-
-   this->data_skip = data_skip;
-   this->data_class = data_class;
-
-   has_data = false;
-
-   data_mode = DATA_MAPPED;
-   
-   this->data_file = new char[ strlen(data_file) + 1 ]; //ok
-   strcpy(this->data_file,data_file);
-
-   try
-   {
-      data_map_file = boost::interprocess::file_mapping(data_file,boost::interprocess::read_only);
-   }
-   catch(std::exception& e)
-   {
-      e = e;
-      return ERR_COULD_NOT_OPEN_MAPPED_FILE;
-   }
-
-   has_data = true;
-
-   int err = 0;
-   if (data_class == DATA_FLOAT)
-      err = CalculateRegions<float>();
-   else if (data_class == DATA_UINT32)
-      err = CalculateRegions<uint32_t>();
-   else
-      err = CalculateRegions<uint16_t>();
-
-   // We can't stream data globally with more than one region
-   if (global_mode == MODE_GLOBAL && n_regions_total > 1)
-      stream_data = false;
-
-   return err;
-
-}
-
-int FLIMData::SetData(float* data)
-{
-   this->data = (void*) data;
-   data_mode = DATA_DIRECT;
-   data_class = DATA_FLOAT;
-   
-   int err = CalculateRegions<float>();
-   
-   has_data = true;
-   
-   return err;
-}
-
-int FLIMData::SetData(uint16_t* data)
-{
-   this->data = (void*) data;
-   data_mode = DATA_DIRECT;
-   data_class = DATA_UINT16;
-
-   int err = CalculateRegions<uint16_t>();
-   
-   has_data = true;
-
-   return err;
-}
-
-int FLIMData::SetData(uint32_t* data)
-{
-   this->data = (void*)data;
-   data_mode = DATA_DIRECT;
-   data_class = DATA_UINT32;
-
-   int err = CalculateRegions<uint32_t>();
-
-   has_data = true;
-
-   return err;
-}
-
-
-double FLIMData::GetPhotonsPerCount()
-{
-   return smoothing_area / counts_per_photon;
-}
-
-void FLIMData::ImageDataFinished(int im)
-{
-   if (stream_data)
-   {
-      for(int i=0; i<n_thread; i++)
-      {
-         if (data_loaded[i] >= 0 && data_loaded[i] == im)
-            MarkCompleted(i);
-      }
-   }
-}
-
-void FLIMData::AllImageLowerDataFinished(int im)
-{
-   if (stream_data)
-   {
-      for(int i=0; i<n_thread; i++)
-      {
-         if (data_loaded[i] >= 0 && data_loaded[i] <= im)
-            MarkCompleted(i);
-      }
-   }
-}
-
-void FLIMData::StartStreaming(bool only_load_non_empty_images, int load_region)
-{
-   if (stream_data && loader_thread == NULL)
-   {
-      DataLoaderThreadParams* params = new DataLoaderThreadParams;
-      params->data = this;
-      params->only_load_non_empty_images = only_load_non_empty_images;
-      params->load_region = load_region;
-
-      loader_thread = new tthread::thread(StartDataLoaderThread,(void*)params); // ok
-   }
-}
-
-void FLIMData::StopStreaming()
-{
-   if (stream_data && loader_thread != NULL)
-   {
-      // Wait for loader thread to terminate
-      if (loader_thread->joinable())
-         loader_thread->join();
-      delete loader_thread;
-      loader_thread = NULL;
-   }
-}
-
-void FLIMData::SetBackground(float* background_image)
-{
-   this->background_image = background_image;
-   this->background_type = BG_IMAGE;
-}
-
-void FLIMData::SetBackground(float background)
-{
-   this->background_value = background;
-   this->background_type = BG_VALUE;
-}
-
-void FLIMData::SetTVBackground(float* tvb_profile, float* tvb_I_map, float const_background)
-{
-   this->tvb_profile = tvb_profile;
-   this->tvb_I_map = tvb_I_map;
-   this->background_value = const_background;
-   this->background_type = BG_TV_IMAGE;
-}
-
-void FLIMData::SetImageT0Shift(double* image_t0_shift)
-{
-   this->image_t0_shift = image_t0_shift;
-}
-
-
-int FLIMData::GetRegionIndex(int im, int region)
-{
-   // If fitting globally, set im=-1 to get index of region for all datasets
-
-   if (global_mode == MODE_GLOBAL)
-         im++;
-
-   return region_idx[region + im * MAX_REGION];
-}
-
-int FLIMData::GetOutputRegionIndex(int im, int region)
-{
-   return output_region_idx[region + im * MAX_REGION];
-}
-
-int FLIMData::GetRegionPos(int im, int region)
-{
-   if (im == -1)
-      im = 0;
-
-   return region_pos[region + im * MAX_REGION];
-}
-
-int FLIMData::GetRegionCount(int im, int region)
-{
-   return region_count[region + im * MAX_REGION];
-}
-
-int FLIMData::GetImLoc(int im)
-{
-   for(int i=0; i<n_im_used; i++)
-   {
-      if (use_im[i] == im)
-         return i;
-   }
-   return -1;
-}
-
-double* FLIMData::GetT()
-{
-   return t + t_skip[0];
-}
-
-void FLIMData::SetExternalResampleIdx(int ext_n_meas_res, int* ext_resample_idx)
-{
-   use_ext_resample_idx = true;
-   this->ext_n_meas_res = ext_n_meas_res;
-   this->ext_resample_idx = ext_resample_idx;
-}
-
-
-int* FLIMData::GetResampleIdx(int thread)
-{
-   if (use_ext_resample_idx)
-      return ext_resample_idx;
-   else
-      return resample_idx + thread * n_t;
-}
-
-int FLIMData::GetResampleNumMeas(int thread)
-{
-   if (use_ext_resample_idx)
-      return ext_n_meas_res;
-   else
-      return n_meas_res[thread];
-}
-
-void FLIMData::DetermineAutoSampling(int thread, float decay[], int n_bin_min)
-{
-   float buf;
-   int idx;
-
-   if (n_chan > 1 || !use_autosampling || use_ext_resample_idx)
-   //if (data_type != DATA_TYPE_TCSPC || n_chan > 1 || !use_autosampling || use_ext_resample_idx)
-      return;
-
-   int* resample_idx = this->resample_idx + n_t * thread;
-
-   int   max_w = n_t / 5;
-   double min_c = 20.0 / smoothing_area;
-   
-   double total_count = 0;
-   
-   int last = -1;
-   for(int i=0; i<n_t; i++)
-   {
-      resample_idx[i] = 0;
-      total_count += decay[i];
-   }
-      
-   if (total_count < n_bin_min*min_c)
-   {
-      min_c = total_count / n_bin_min;
-   }
-
-   resample_idx[n_t-1] = 0;
-   float c = decay[n_t-1];
-   int w = 0;
-   int n_bin = 1;
-   for (int i=n_t-2; i>=0; i--)
-   {
-      if ( c < min_c && w < max_w )
-      {
-         c += decay[i];
-         w++;
-      }
-      else
-      {
-         c = decay[i];
-         resample_idx[i] = 1;
-         last = i;
-         w = 1;
-         n_bin++;
-      }
-   }
-
-   if ((c < min_c) && (n_bin > n_bin_min))
-      resample_idx[last] = 0;
-
-   n_meas_res[thread] = n_bin * n_chan;
-
-
-   // Now resample data provided
-   idx = 0;
-   for(int k=0; k<n_chan; k++)
-   {
-      for(int i=0; i<n_t; i++)
-      {
-         buf = decay[k*n_t + i];
-         decay[k*n_t + i] = 0;
-         decay[idx] += buf;
-         idx += resample_idx[i];
-      }
-      idx++;
-   }
-
-
-}
-
-
-int FLIMData::GetRegionData(int thread, int group, int region, int px, float* region_data, float* intensity_data, float* r_ss_data, float* acceptor_data, int* irf_idx, float* local_decay, int n_thread)
-{
-   int s = 0;
-
-   if ( global_mode == MODE_IMAGEWISE )
-   {
-      s = GetMaskedData(thread, group, region, region_data, intensity_data, r_ss_data, acceptor_data, irf_idx);
-   }
-   else if ( global_mode == MODE_GLOBAL )
-   {
-      s = 0;
-      int start = GetRegionPos(0, region);
-       
-      // we want dynamic with a chunk size of 1 as the data is being pulled from VM in order
-      #pragma omp parallel for reduction(+:s) schedule(dynamic, 1) num_threads(n_thread)
-      for(int i=0; i<n_im_used; i++)
-      {
-         if (!status->terminate)
-         {
-            // This thread index will only be used if we're not streaming data,
-            // make sure that we pass the right one in
-            int r_thread;
-            if (n_thread == 1)
-               r_thread = thread;
-            else
-               r_thread = omp_get_thread_num();
-
-            int pos = GetRegionPos(i, region) - start;
-            if (GetRegionCount(i, region) > 0)
-               s += GetMaskedData(r_thread, i, region, region_data + pos*n_meas, intensity_data + pos, r_ss_data + pos, acceptor_data + pos, irf_idx + pos);
-            ImageDataFinished(i);
-         }
-      }
-   }
-
-   memset(local_decay,0, n_meas * sizeof(float));
-
-   for(int i=0; i<s; i++)
-      for(int j=0; j<n_meas; j++)
-         local_decay[j] += region_data[i*n_meas + j];
-      
-   for(int j=0; j<n_meas; j++)
-      local_decay[j] /= s;
-
-   return s;
-}
-
-
-int FLIMData::GetMaskedData(int thread, int im, int region, float* masked_data, float* masked_intensity, float* masked_r_ss, float* masked_acceptor, int* irf_idx)
-{
-   
-   int iml = im;
-   if (use_im != NULL)
-      iml = use_im[im];
-
-   mask_type* im_mask = mask + iml*n_x*n_y;
-   float*   tr_data   = tr_data_ + thread * n_p;
-   float*   intensity = intensity_ + thread * n_px;
-   float*   r_ss      = r_ss_ + thread * n_px;
-   float*   acceptor  = acceptor_ + iml*n_x*n_y;
-
-   if (data_class == DATA_FLOAT)
-      TransformImage<float>(thread, im);
-   else if (data_class == DATA_UINT32)
-      TransformImage<uint32_t>(thread, im);
-   else
-      TransformImage<uint16_t>(thread, im);
-
-   // Store masked values
-   int s = 0;
-
-   for(int p=0; p<n_px; p++)
-   {
-      if (region < 0 || im_mask[p] == region || (merge_regions && im_mask[p] > 0))
-      {
-         masked_intensity[s] = intensity[p];
-   
-         if (polarisation_resolved)
-            masked_r_ss[s] = r_ss[p];
-
-         if (has_acceptor)
-            masked_acceptor[s] = acceptor[p];
-            
-         for(int i=0; i<n_meas; i++)
-            masked_data[s*n_meas+i] = tr_data[p*n_meas+i];
-
-
-         irf_idx[s] = iml*n_px+p;
-         s++;
-      }
-   }
-
-   return s;
-}
-
-
-
-void FLIMData::ClearMapping()
-{
-   if (data_map_view == NULL)
-      return;
-   for(int i=0; i<n_thread; i++)
-      data_map_view[i] = boost::interprocess::mapped_region();
-}
-
-
-
-FLIMData::~FLIMData()
-{
-   ClearMapping();
-
-   delete[] tr_data_;
-   delete[] tr_buf_;
-   delete[] tr_row_buf_;
-   delete[] intensity_;
-
-   delete[] cur_transformed;
-   delete[] resample_idx;
-   delete[] data_map_view;
-   delete[] n_meas_res;
- 
-   delete[] data_used;
-   delete[] data_loaded;
-
-   delete[] t_skip;
-   delete[] region_count;
-   delete[] region_pos;
-   delete[] region_idx;
-   delete[] output_region_idx;
-
-   delete[] use_im;
-
-   if (!supplied_mask) 
-      delete[] mask;
-   
-   if (polarisation_resolved)
-      delete[] r_ss_;
-  
-   if (data_file != NULL)
-      delete[] data_file;
-
-   if (loader_thread != NULL)
-      delete loader_thread;
-}
-
-
-
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+
+#include "FLIMData.h"
+#include <cmath>
+#include <cstdio>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+//#include "hdf5.h"
+
+template <typename T>
+static void AppendKey(std::vector<char>& key, const T* values, size_t n)
+{
+   const char* ptr = (const char*) values;
+   key.insert(key.end(), ptr, ptr + n * sizeof(T));
+}
+
+FLIMData::FLIMData(int polarisation_resolved, double g_factor, int n_im, int n_x, int n_y, int n_chan, int n_t_full, double t[], double t_int[], int t_skip[], int n_t, int time_bin, int data_type, 
+                   int* use_im, mask_type mask[], int merge_regions, int threshold, int limit, double counts_per_photon, int global_mode, int smoothing_factor, int use_autosampling, int tile_px, int n_thread, FitStatus* status) :
+   polarisation_resolved(polarisation_resolved),
+   g_factor(g_factor),
+   n_im(n_im), 
+   n_x(n_x),
+   n_y(n_y),
+   n_chan(n_chan),
+   n_t_full(n_t_full),
+   t(t),
+   t_int(t_int),
+   n_t(n_t),
+   data_type(data_type),
+   mask(mask),
+   merge_regions(merge_regions),
+   threshold(threshold),
+   limit(limit),
+   counts_per_photon(counts_per_photon),
+   smoothing_factor(smoothing_factor),
+   use_autosampling(use_autosampling),
+   n_thread(n_thread),
+   status(status)
+{
+   has_data = false;
+   has_acceptor = false;
+
+   data_file = NULL;
+   acceptor_  = NULL;
+   streaming = false;
+
+
+   image_t0_shift = NULL;
+
+   cache_limit = 0;
+   cache_used = 0;
+   cache_class = DATA_FLOAT;
+
+   prefetch_limit = 256.0 * 1024 * 1024;
+   n_loader_thread = 1;
+   n_loader_running = 0;
+   load_error = SUCCESS;
+
+   n_slot = 0;
+   n_slot_alloc = 0;
+   slot_image = NULL;
+   slot_seq = NULL;
+   slot_cond = NULL;
+   next_load = 0;
+   stop_loading = false;
+
+
+   // So that we can calculate errors properly
+   if (global_mode == MODE_PIXELWISE && n_x == 1 && n_y == 1)
+      global_mode = MODE_IMAGEWISE;
+
+   this->global_mode = global_mode;
+
+   stream_data = STREAM_DATA;
+
+   n_masked_px = 0;
+
+   // Make sure we exclude very dim pixels which 
+   // can break the autosampling (we might end up with only one bin!)
+   if (threshold < 3)
+      threshold = 3;
+
+   supplied_mask = (mask != NULL);
+
+   if (!supplied_mask)
+   {
+      int sz_mask = n_im * n_x * n_y;
+      this->mask = new mask_type[sz_mask]; //ok
+      supplied_mask = false;
+      for(int i=0; i<sz_mask; i++)
+         this->mask[i] = 1;
+   }
+
+
+   this->use_im = new int[n_im];
+
+   n_im_used = 0;
+   if (use_im != NULL)
+   {
+      for(int i=0; i<n_im; i++)
+      {
+         if (use_im[i])
+            for(int j=0; j<n_x*n_y; j++)
+               if(this->mask[i*n_x*n_y+j] > 0)
+               {
+                  this->use_im[n_im_used] = i;
+                  n_im_used++;
+                  break;
+               }
+      }
+   }
+   else
+   {
+      n_im_used = n_im;
+   }
+
+   this->t_skip = new int[n_chan]; //ok
+   if (t_skip == NULL)
+   {
+      for(int i=0; i<n_chan; i++)
+         this->t_skip[i] = 0;
+   }
+   else
+   {
+      for(int i=0; i<n_chan; i++)
+         this->t_skip[i] = t_skip[i];
+   }
+
+   src_n_t_full = n_t_full;
+   src_n_t = n_t;
+   src_t_skip.assign(this->t_skip, this->t_skip + n_chan);
+
+   this->time_bin = std::max(time_bin, 1);
+   if (this->time_bin > 1)
+      RebinTimepoints();
+
+   n_meas = n_chan * this->n_t;
+   n_meas_full = n_chan * this->n_t_full;
+
+   background_value = 0;
+   background_type = BG_NONE;
+
+   if (n_thread < 1)
+      n_thread = 1;
+
+   n_px = n_x * n_y;
+   n_p  = n_x * n_y * n_meas_full;
+
+   // Tiles are bands of whole rows, so smoothing in x needs no halo. The
+   // halo rows needed to smooth in y are read straight from the source data
+   tile_rows = n_y;
+   if (this->global_mode == MODE_PIXELWISE && tile_px > 0)
+      tile_rows = std::min(std::max(tile_px / n_x, 1), n_y);
+   n_tile = (n_y + tile_rows - 1) / tile_rows;
+
+
+   region_count = new int[ n_im_used * MAX_REGION ];
+   region_pos   = new int[ n_im_used * MAX_REGION ];
+   region_idx   = new int[ (n_im_used+1) * MAX_REGION ];
+   output_region_idx   = new int[ n_im_used * MAX_REGION ];
+
+   for (int i=0; i<n_im_used * MAX_REGION; i++)
+   {
+      region_count[i] = 0;
+      region_pos[i] = 0;
+      region_idx[i] = -1;
+      output_region_idx[i] = -1;
+   }
+   for (int i=0; i<MAX_REGION; i++)
+      region_idx[n_im_used * MAX_REGION + i] = -1;
+   
+   drop_behind = false;
+   default_index_file = true;
+
+   scan = std::make_shared<ScanData>();
+
+   // Rebinned images are summed into tr_buf_ as they're loaded
+   tr_buf_ = (this->time_bin > 1) ? new float[ n_thread * n_p ] : NULL; //ok
+   if (this->time_bin > 1)
+      src_peak_.resize((size_t) n_thread * n_px);
+   tr_buf_image = new int[n_thread]; //ok
+   slot_buf_ = NULL;
+   slot_buf_size = 0;
+
+   photon_im_offset = NULL;
+   photon_pixel = NULL;
+   photon_chan = NULL;
+   photon_time = NULL;
+   photon_time_div = 1;
+
+   reader = NULL;
+
+   cur_transformed = new int[n_thread]; //ok 
+
+
+   for (int i=0; i<n_thread; i++)
+   {
+      cur_transformed[i] = -1;
+      tr_buf_image[i] = -1;
+   }
+
+   int dim_required = smoothing_factor*2 + 2;
+   if (n_x < dim_required || n_y < dim_required)
+      this->smoothing_factor = 0;
+
+   smoothing_area = (2*this->smoothing_factor+1)*(2*this->smoothing_factor+1);
+
+   // Running sums used for smoothing; for each thread we need one
+   // row of sums plus a copy of a row of data
+   if (this->smoothing_factor > 0)
+   {
+      smooth_buf_ = new double[ n_thread * (n_x+1) * n_meas ];
+      support_flag_ = new uint8_t[ n_thread * tile_rows * n_x ]; //ok
+      memset(support_flag_, 0, n_thread * tile_rows * n_x * sizeof(uint8_t));
+   }
+   else
+   {
+      smooth_buf_ = NULL;
+      support_flag_ = NULL;
+   }
+
+   // When tiling, only the masked pixels of one band are transformed at a time
+   // and tr_data is just scratch space for smoothing the band
+   if (n_tile > 1)
+   {
+      tr_data_size = (this->smoothing_factor > 0) ? (size_t) tile_rows * n_x * n_meas : 0;
+      r_ss_ = NULL;
+   }
+   else
+   {
+      tr_data_size = n_p;
+      if (polarisation_resolved)
+         r_ss_ = new float[ n_thread * n_px ];
+   }
+   tr_data_ = new float[ n_thread * tr_data_size ]; //ok
+
+   resample_idx = new int[this->n_t * n_thread]; //ok
+   n_meas_res = new int[n_thread]; //ok
+
+   use_ext_resample_idx = 0;
+   ext_resample_idx = NULL;
+   ext_n_meas_res = 0;
+   
+   for(int j=0; j<n_thread; j++)
+   {
+      for(int i=0; i<this->n_t-1; i++)
+         resample_idx[j*this->n_t+i] = 1;
+      
+      resample_idx[j*this->n_t+this->n_t-1] = 0;
+
+      n_meas_res[j] = this->n_t * n_chan;
+   }
+
+
+}
+
+
+/**
+ * Check that at least one time bin is left once the data has been cropped 
+ * and rebinned by time_bin. Must pass before a FLIMData is constructed
+ */
+int FLIMData::CheckTimeBinning(int n_chan, int n_t_full, const int t_skip[], int n_t, int time_bin)
+{
+   time_bin = std::max(time_bin, 1);
+
+   if (n_chan < 1 || n_t < 1 || time_bin > n_t_full)
+      return ERR_INVALID_INPUT;
+
+   int n_t_rebin = n_t_full / time_bin;
+   for(int c=0; c<n_chan; c++)
+   {
+      int skip = (t_skip == NULL) ? 0 : t_skip[c];
+      if (skip < 0)
+         return ERR_INVALID_INPUT;
+
+      int start = (skip + time_bin - 1) / time_bin;
+      int end = std::min((skip + n_t) / time_bin, n_t_rebin);
+      if (end - start < 1)
+         return ERR_INVALID_INPUT;
+   }
+
+   return SUCCESS;
+}
+
+/**
+ * Set up the time points of the rebinned data. Each rebinned bin takes the
+ * t_int weighted mean time of its source bins and the sum of their t_int. 
+ * Only rebinned bins which lie entirely within the cropped source data are used.
+ * Requires CheckTimeBinning to have passed, so at least one bin is left
+ */
+void FLIMData::RebinTimepoints()
+{
+   n_t_full = src_n_t_full / time_bin;
+
+   rebin_t.resize(n_t_full);
+   rebin_t_int.resize(n_t_full);
+
+   for(int i=0; i<n_t_full; i++)
+   {
+      double sum_t = 0, sum_int = 0;
+      for(int k=i*time_bin; k<(i+1)*time_bin; k++)
+      {
+         sum_t   += t[k] * t_int[k];
+         sum_int += t_int[k];
+      }
+
+      if (sum_int > 0)
+         rebin_t[i] = sum_t / sum_int;
+      else
+         rebin_t[i] = 0.5 * (t[i*time_bin] + t[(i+1)*time_bin-1]);
+      rebin_t_int[i] = sum_int;
+   }
+
+   t = &rebin_t[0];
+   t_int = &rebin_t_int[0];
+
+   n_t = n_t_full;
+   for(int c=0; c<n_chan; c++)
+   {
+      t_skip[c] = (src_t_skip[c] + time_bin - 1) / time_bin;
+      int end = std::min((src_t_skip[c] + src_n_t) / time_bin, n_t_full);
+      n_t = std::min(n_t, end - t_skip[c]);
+   }
+}
+
+/**
+ * Wrapper function for DataLoaderThread
+ */
+void StartDataLoaderThread(void* wparams)
+{
+   FLIMData* data = (FLIMData*) wparams;
+   data->DataLoaderThread();
+
+   // Let StopStreaming know we're done
+   data->data_mutex.lock();
+   data->n_loader_running--;
+   data->loader_cond.notify_all();
+   data->data_mutex.unlock();
+}
+
+/**
+ * Loader thread; takes the next image in the load list, waits for its slot 
+ * to be released and then brings the image into memory. Several of these 
+ * may run at once
+ */
+void FLIMData::DataLoaderThread()
+{
+   int n_load = (int) load_list.size();
+
+   while(true)
+   {
+      data_mutex.lock();
+      int k = next_load++;
+      data_mutex.unlock();
+
+      if (k >= n_load)
+         break;
+
+      int s = k % n_slot;
+
+      // Wait for the image that was in the slot before us to be released
+      data_mutex.lock();
+      while (slot_seq[s] != k && !status->terminate && !stop_loading)
+         slot_cond[s].wait(data_mutex);
+      data_mutex.unlock();
+
+      if (status->terminate || stop_loading)
+         break;
+
+      // Fault (or decode) the image on this thread so that the 
+      // workers don't stall on I/O when they get to it
+      if (data_mode == DATA_COMPRESSED || data_mode == DATA_READER)
+      {
+         int err = ReadImage(load_list[k], GetSlotBuffer(s), (time_bin > 1) ? &src_peak_[(size_t) (n_thread + s) * n_px] : NULL);
+         
+         // The slot is never marked as holding the image, so nothing fits it
+         if (err != SUCCESS)
+         {
+            LoadFailed(err);
+            break;
+         }
+      }
+      else
+         PrefetchImage(load_list[k]);
+
+      data_mutex.lock();
+      slot_image[s] = load_list[k];
+      data_mutex.unlock();
+
+      slot_cond[s].notify_all();
+   }
+}
+
+/**
+ * Record an error reading an image and terminate the fit, waking anything 
+ * waiting for an image to be loaded
+ */
+void FLIMData::LoadFailed(int err)
+{
+   data_mutex.lock();
+   if (load_error == SUCCESS)
+      load_error = err;
+   data_mutex.unlock();
+
+   status->terminate = true;
+
+   for(int i=0; i<n_slot; i++)
+      slot_cond[i].notify_all();
+}
+
+/**
+ * Release an image from a slot, allowing the next image to be loaded into it
+ */
+void FLIMData::MarkCompleted(int slot, int im)
+{
+   data_mutex.lock();
+   bool release = (slot_image[slot] == im);
+   if (release)
+   {
+      slot_image[slot] = -1;
+      slot_seq[slot] += n_slot;
+   }
+   data_mutex.unlock();
+
+   if (release)
+   {
+      slot_cond[slot].notify_all();
+      ReleaseImage(im);
+   }
+}
+
+/**
+ * Get the buffer an image in a slot is decoded into, which holds n_p values of data_class
+ */
+void* FLIMData::GetSlotBuffer(int slot)
+{
+   return slot_buf_ + slot * (size_t) n_p * DataClassSize(data_class);
+}
+
+/**
+ * Make sure we have at least n_slot_required slots available
+ */
+void FLIMData::AllocateSlots(int n_slot_required)
+{
+   bool needs_buf = (data_mode == DATA_COMPRESSED || data_mode == DATA_READER);
+   size_t buf_size = std::max(n_slot_required, n_slot_alloc) * (size_t) n_p * DataClassSize(data_class);
+   if (needs_buf && buf_size > slot_buf_size)
+   {
+      delete[] slot_buf_;
+      slot_buf_ = new char[ buf_size ]; //ok
+      slot_buf_size = buf_size;
+   }
+
+   if (needs_buf && time_bin > 1)
+   {
+      size_t peak_size = (size_t) (n_thread + std::max(n_slot_required, n_slot_alloc)) * n_px;
+      if (peak_size > src_peak_.size())
+         src_peak_.resize(peak_size);
+   }
+
+   if (n_slot_required <= n_slot_alloc)
+      return;
+
+   for(int i=0; i<n_slot_alloc; i++)
+      status->RemoveConditionVariable(slot_cond+i);
+
+   delete[] slot_image;
+   delete[] slot_seq;
+   delete[] slot_cond;
+
+   n_slot_alloc = n_slot_required;
+
+   slot_image = new int[n_slot_alloc];
+   slot_seq   = new int[n_slot_alloc];
+   slot_cond  = new tthread::condition_variable[n_slot_alloc];
+
+   // Make sure waiting threads are notified when we terminate
+   for(int i=0; i<n_slot_alloc; i++)
+      status->AddConditionVariable(slot_cond+i);
+}
+
+/*
+{
+
+//===================================================================================//
+
+   #define FILE            "c:\\users\\scw09\\Documents\\h5ex_d_hyper.h5"
+   #define DATASET         "DS1"
+   #define DIM0            6
+   #define DIM1            8
+
+    int rdata[DIM0][DIM1];
+
+    hid_t  file = H5Fopen (FILE, H5F_ACC_RDONLY, H5P_DEFAULT);
+    hid_t  dset = H5Dopen (file, DATASET, H5P_DEFAULT);
+
+    herr_t status = H5Dread (dset, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, rdata[0]);
+
+    hsize_t     dims[2] = {DIM0, DIM1},
+                start[2],
+                stride[2],
+                count[2],
+                block[2];
+
+
+    // Define and select the hyperslab to use for reading.
+
+    hid_t space = H5Dget_space (dset);
+    start[0]  = 0;
+    start[1]  = 1;
+    stride[0] = 4;
+    stride[1] = 4;
+    count[0]  = 2;
+    count[1]  = 2;
+    block[0]  = 2;
+    block[1]  = 3;
+    status = H5Sselect_hyperslab (space, H5S_SELECT_SET, start, stride, count, block);
+
+    // Read the data using the previously defined hyperslab.
+     
+    status = H5Dread (dset, H5T_NATIVE_INT, H5S_ALL, space, H5P_DEFAULT,
+                rdata[0]);
+
+    //===================================================================================//
+
+
+}
+*/
+
+int FLIMData::SetAcceptor(float acceptor[])
+{
+   this->acceptor_ = acceptor;
+   has_acceptor = true;
+
+   return SUCCESS;
+}
+
+/**
+ * Set the maximum memory (in MB) used to retain transformed decays from the
+ * region scan. Images which fit within the limit are not re-read during fitting.
+ * Must be called before the data is set.
+ */
+void FLIMData::SetCacheLimit(double cache_limit_mb)
+{
+   cache_limit = cache_limit_mb * 1024 * 1024;
+}
+
+/**
+ * Set the type used to store the cached transformed decays; DATA_FLOAT 
+ * (default) or DATA_FLOAT16, which doubles the number of images that fit
+ * in the cache at the cost of precision. Must be called before the data is set.
+ */
+int FLIMData::SetCacheClass(int cache_class)
+{
+   if (cache_class != DATA_FLOAT && cache_class != DATA_FLOAT16)
+      return ERR_INVALID_INPUT;
+
+   this->cache_class = cache_class;
+   return SUCCESS;
+}
+
+/**
+ * Set the maximum memory (in MB) of data the loader threads may bring in 
+ * ahead of the fitting threads, and the number of loader threads to use 
+ * when reading from a file
+ */
+void FLIMData::SetPrefetchParams(double prefetch_limit_mb, int n_loader_thread)
+{
+   prefetch_limit = prefetch_limit_mb * 1024 * 1024;
+   this->n_loader_thread = std::max(n_loader_thread, 1);
+}
+
+/**
+ * Get the modification time of a file in ns, at the resolution the platform provides
+ */
+static uint64_t GetModificationTime(const char* file)
+{
+   struct stat file_stat;
+   if (stat(file, &file_stat) != 0)
+      return 0;
+
+   uint64_t mtime = (uint64_t) file_stat.st_mtime * 1000000000ULL;
+#if defined(__APPLE__)
+   mtime += file_stat.st_mtimespec.tv_nsec;
+#elif !defined(_WIN32)
+   mtime += file_stat.st_mtim.tv_nsec;
+#endif
+   return mtime;
+}
+
+/**
+ * Set the sidecar index file used for data files. Pass NULL to use the 
+ * default (the first data file with a hash of the data parameters and .idx
+ * appended) or an empty string to disable the index. Must be set before 
+ * the data files
+ */
+void FLIMData::SetIndexFile(const char* index_file)
+{
+   default_index_file = (index_file == NULL);
+   this->index_file = (index_file == NULL) ? "" : index_file;
+}
+
+bool FLIMData::IsCached(int im)
+{
+   return im < (int) scan->cached_data.size() && (!scan->cached_data[im].empty() || !scan->cached_data_f16[im].empty());
+}
+
+int FLIMData::SetData(char* data_file, int data_class, int data_skip)
+{
+   return SetData(1, &data_file, data_class, data_skip);
+}
+
+/**
+ * Use data from a list of files, each holding one or more images, which are 
+ * numbered consecutively through the files. Each file must either hold raw 
+ * data of data_class following a header of data_skip bytes, or be a 
+ * compressed container. The loader threads prefetch across file boundaries
+ */
+int FLIMData::SetData(int n_file, char** data_files, int data_class, int data_skip)
+{
+   ClearMapping();
+
+   if (n_file < 1 || data_files == NULL)
+      return ERR_INVALID_INPUT;
+
+   this->data_skip = data_skip;
+   SetDataClass(data_class);
+
+   has_data = false;
+
+   data_mode = DATA_MAPPED;
+   
+   delete[] this->data_file;
+   this->data_file = new char[ strlen(data_files[0]) + 1 ]; //ok
+   strcpy(this->data_file,data_files[0]);
+
+   size_t im_size = (size_t) src_n_t_full * n_chan * n_px * DataClassSize(src_class);
+   unsigned long long total_size = 0;
+
+   // The index is keyed on the size and modification time of each file
+   std::vector<uint64_t> index_key;
+   index_key.push_back(n_file);
+   int n_file_im = 0;
+   bool compressed = false;
+
+   for(int f=0; f<n_file; f++)
+   {
+      DataFile* df = new DataFile; //ok
+      this->data_files.push_back(df);
+
+      try
+      {
+         df->map_file = boost::interprocess::file_mapping(data_files[f],boost::interprocess::read_only);
+      }
+      catch(std::exception& e)
+      {
+         e = e;
+         ClearMapping();
+         return ERR_COULD_NOT_OPEN_MAPPED_FILE;
+      }
+
+      try
+      {
+         df->map_region = boost::interprocess::mapped_region(df->map_file,boost::interprocess::read_only);
+      }
+      catch(std::exception& e)
+      {
+         e = e;
+         ClearMapping();
+         return ERR_FAILED_TO_MAP_DATA;
+      }
+
+      df->map_ptr  = (char*) df->map_region.get_address();
+      df->map_size = df->map_region.get_size();
+      df->first_im = n_file_im;
+
+      index_key.push_back(df->map_size);
+      index_key.push_back(GetModificationTime(data_files[f]));
+
+      size_t skip = std::min((size_t) data_skip, df->map_size);
+      bool is_compressed = CompressedData::IsCompressedData(df->map_ptr + skip, df->map_size - skip);
+
+      // We can't mix raw and compressed files
+      if (f > 0 && is_compressed != compressed)
+      {
+         ClearMapping();
+         return ERR_FAILED_TO_MAP_DATA;
+      }
+      compressed = is_compressed;
+
+      if (compressed)
+      {
+         // Chunked container; check it matches the data we've been told about
+         if (df->compressed.Open(df->map_ptr + skip, df->map_size - skip) != SUCCESS ||
+             df->compressed.GetNumPixels() != n_px ||
+             df->compressed.GetNumMeas() != n_chan * src_n_t_full ||
+             df->compressed.GetDataClass() != this->data_files[0]->compressed.GetDataClass())
+         {
+            ClearMapping();
+            return ERR_FAILED_TO_MAP_DATA;
+         }
+         df->n_im = df->compressed.GetNumImages();
+      }
+      else
+      {
+         df->n_im = (int) ((df->map_size - skip) / im_size);
+      }
+
+      n_file_im  += df->n_im;
+      total_size += df->map_size;
+
+      // We read through each file in order, so let the OS read ahead aggressively
+      df->map_region.advise(boost::interprocess::mapped_region::advice_sequential);
+#ifndef _WIN32
+      posix_fadvise(df->map_file.get_mapping_handle().handle, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+   }
+
+   // Make sure all the images we're going to use are actually in the files
+   int max_im = n_im - 1;
+   if (use_im != NULL)
+      for(int i=0; i<n_im_used; i++)
+         max_im = std::max(max_im, use_im[i]);
+
+   if (n_file_im <= max_im)
+   {
+      ClearMapping();
+      return ERR_FAILED_TO_MAP_DATA;
+   }
+
+   if (compressed)
+   {
+      data_mode = DATA_COMPRESSED;
+      SetDataClass(this->data_files[0]->compressed.GetDataClass());
+
+      delete[] tr_buf_;
+      tr_buf_ = new float[ n_thread * n_p ]; //ok
+   }
+
+#ifndef _WIN32
+   // If the files won't comfortably fit in memory, drop each image from 
+   // the page cache once we've finished with it so we don't evict everything else
+   unsigned long long phys_mem = (unsigned long long) sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+   drop_behind = (data_mode == DATA_MAPPED) && (total_size > phys_mem / 2);
+#endif
+
+   // ... and on the data parameters the scan depends on
+   size_t n_file_key = index_key.size();
+   index_key.push_back(data_skip);
+   index_key.push_back(src_class);
+   index_key.push_back(n_x);
+   index_key.push_back(n_y);
+   index_key.push_back(n_chan);
+   index_key.push_back(src_n_t_full);
+   index_key.push_back(time_bin);
+
+   source_key.clear();
+   for(int f=0; f<n_file; f++)
+      source_key.insert(source_key.end(), data_files[f], data_files[f] + strlen(data_files[f]) + 1);
+   AppendKey(source_key, &index_key[0], index_key.size());
+
+   // Fits of the same files with different parameters get their own default 
+   // index, so they don't keep replacing each other's
+   std::string index_path = index_file;
+   if (default_index_file)
+   {
+      char hash[17];
+      uint64_t h = DataIndex::HashKey(&index_key[n_file_key], index_key.size() - n_file_key);
+      snprintf(hash, sizeof(hash), "%08x%08x", (unsigned int) (h >> 32), (unsigned int) h);
+      index_path = std::string(data_files[0]) + "." + hash + ".idx";
+   }
+   if (!index_path.empty())
+      data_index.Open(index_path.c_str(), index_key, n_file_im, n_px);
+
+   has_data = true;
+
+   int err = CalculateRegions();
+
+   return err;
+
+}
+
+/**
+ * Set the class of the source data. Rebinned data is summed into float buffers
+ */
+void FLIMData::SetDataClass(int src_class)
+{
+   this->src_class = src_class;
+   data_class = (time_bin > 1) ? DATA_FLOAT : src_class;
+}
+
+/**
+ * Check if the index holds a scan of every image we're using. If we don't 
+ * need to fill the cache, the masks can then be calculated without reading 
+ * the data
+ */
+bool FLIMData::ScanInIndex()
+{
+   if (!data_index.IsOpen() || cache_limit > 0)
+      return false;
+
+   if (data_mode != DATA_MAPPED && data_mode != DATA_COMPRESSED)
+      return false;
+
+   for(int i=0; i<n_im_used; i++)
+   {
+      int im = (use_im != NULL) ? use_im[i] : i;
+      if (!data_index.HasImage(im))
+         return false;
+   }
+   return true;
+}
+
+/**
+ * Describe the data files and every parameter the scan and transformed data
+ * depend on, so the scan can be shared with other fits of the same data. 
+ * Returns an empty key if the scan can't be shared
+ */
+std::vector<char> FLIMData::GetScanKey()
+{
+   std::vector<char> key;
+
+   if (!TransformCache::IsEnabled() || source_key.empty())
+      return key;
+
+   if (data_mode != DATA_MAPPED && data_mode != DATA_COMPRESSED)
+      return key;
+
+   int params[] = { polarisation_resolved, n_im, n_x, n_y, n_chan, src_n_t_full, src_n_t, time_bin, src_class, data_type, 
+                    threshold, limit, smoothing_factor, background_type, cache_class, n_im_used };
+   double fparams[] = { g_factor, counts_per_photon, background_value, cache_limit };
+
+   AppendKey(key, &source_key[0], source_key.size());
+   AppendKey(key, params, sizeof(params) / sizeof(int));
+   AppendKey(key, fparams, sizeof(fparams) / sizeof(double));
+   AppendKey(key, &src_t_skip[0], src_t_skip.size());
+   AppendKey(key, use_im, n_im_used);
+
+   for(int i=0; i<n_im_used; i++)
+      AppendKey(key, mask + use_im[i] * n_px, n_px);
+
+   if (background_type == BG_IMAGE)
+      AppendKey(key, background_image, n_px);
+   
+   if (background_type == BG_TV_IMAGE)
+   {
+      AppendKey(key, tvb_profile, n_meas);
+      AppendKey(key, tvb_I_map, n_px);
+   }
+
+   return key;
+}
+
+/**
+ * Keep the mask of each image we're using after scanning, so that a fit 
+ * sharing the scan can restore it
+ */
+void FLIMData::SaveScanMask()
+{
+   scan->mask.resize((size_t) n_im_used * n_px);
+   for(int i=0; i<n_im_used; i++)
+      memcpy(&scan->mask[(size_t) i * n_px], mask + use_im[i] * n_px, n_px * sizeof(mask_type));
+}
+
+void FLIMData::RestoreScanMask()
+{
+   for(int i=0; i<n_im_used; i++)
+      memcpy(mask + use_im[i] * n_px, &scan->mask[(size_t) i * n_px], n_px * sizeof(mask_type));
+}
+
+/**
+ * Apply the background, minimum intensity and saturation masks to an image 
+ * given the integrated intensity and peak value of each pixel, and record
+ * the masked pixels and their intensities
+ */
+void FLIMData::MaskImage(int i, const double* sum, const double* peak, double tvb_sum, int n_mask_thread)
+{
+   int im = i;
+   if (use_im != NULL)
+      im = use_im[im];
+
+   mask_type* im_mask = mask + im*n_px;
+
+   std::vector<float> intensity(n_px);
+
+   #pragma omp parallel for num_threads(n_mask_thread)
+   for(int p=0; p<n_px; p++)
+   {
+      bool saturated = (limit > 0 && peak[p] >= limit);
+      double I = sum[p];
+
+      if (background_type == BG_VALUE)
+         I -= background_value * n_meas_full;
+      else if (background_type == BG_IMAGE)
+         I -= background_image[p] * time_bin * n_meas_full;
+      else if (background_type == BG_TV_IMAGE)
+         I -= (tvb_sum * tvb_I_map[p] + background_value * n_meas_full);
+
+      intensity[p] = (float) I;
+
+      if (saturated || I < threshold || im_mask[p] >= MAX_REGION)
+         im_mask[p] = 0;
+   }
+
+   std::vector<int>&   px_idx = scan->masked_px_idx[i];
+   std::vector<float>& px_I   = scan->masked_px_intensity[i];
+
+   for(int p=0; p<n_px; p++)
+   {
+      if (im_mask[p] > 0)
+      {
+         px_idx.push_back(p);
+         px_I.push_back(intensity[p]);
+      }
+   }
+}
+
+int FLIMData::CalculateRegions()
+{
+   if (data_class == DATA_FLOAT)
+      return CalculateRegions<float>();
+   else if (data_class == DATA_UINT32)
+      return CalculateRegions<uint32_t>();
+   else if (data_class == DATA_UINT8)
+      return CalculateRegions<uint8_t>();
+   else if (data_class == DATA_FLOAT16)
+      return CalculateRegions<float16>();
+   else
+      return CalculateRegions<uint16_t>();
+}
+
+int FLIMData::SetData(float* data)
+{
+   this->data = (void*) data;
+   data_mode = DATA_DIRECT;
+   SetDataClass(DATA_FLOAT);
+   
+   int err = CalculateRegions();
+   
+   has_data = true;
+   
+   return err;
+}
+
+int FLIMData::SetData(uint8_t* data)
+{
+   this->data = (void*) data;
+   data_mode = DATA_DIRECT;
+   SetDataClass(DATA_UINT8);
+
+   int err = CalculateRegions();
+   
+   has_data = true;
+
+   return err;
+}
+
+/**
+ * Use IEEE half precision data
+ */
+int FLIMData::SetData(float16* data)
+{
+   this->data = (void*) data;
+   data_mode = DATA_DIRECT;
+   SetDataClass(DATA_FLOAT16);
+
+   int err = CalculateRegions();
+   
+   has_data = true;
+
+   return err;
+}
+
+int FLIMData::SetData(uint16_t* data)
+{
+   this->data = (void*) data;
+   data_mode = DATA_DIRECT;
+   SetDataClass(DATA_UINT16);
+
+   int err = CalculateRegions();
+   
+   has_data = true;
+
+   return err;
+}
+
+/**
+ * Read data directly from an instrument file using a FLIMReader. We take
+ * ownership of the reader
+ */
+int FLIMData::SetData(FLIMReader* reader)
+{
+   delete this->reader;
+   this->reader = reader;
+
+   if (reader == NULL)
+      return ERR_INVALID_INPUT;
+
+   int max_im = n_im - 1;
+   if (use_im != NULL)
+      for(int i=0; i<n_im_used; i++)
+         max_im = std::max(max_im, use_im[i]);
+
+   if (reader->GetNumX() != n_x || reader->GetNumY() != n_y || 
+       reader->GetNumChannels() != n_chan || reader->GetNumTimebins() != src_n_t_full ||
+       reader->GetNumImages() <= max_im)
+      return ERR_INVALID_INPUT;
+
+   reader->SetNumThreads(n_thread);
+
+   data_mode = DATA_READER;
+   SetDataClass(reader->GetDataClass());
+
+   delete[] tr_buf_;
+   tr_buf_ = new float[ n_thread * n_p ]; //ok
+
+   int err = CalculateRegions();
+
+   has_data = true;
+
+   return err;
+}
+
+/**
+ * Use photon event lists as the data. Histograms for each image are built 
+ * as needed, with the micro time of each photon divided by photon_time_div
+ * to get its time bin. photon_chan may be NULL if there is only one channel.
+ * The arrays must remain valid until the fit is complete. If we're rebinning
+ * the photons are histogrammed straight into the rebinned time bins
+ */
+int FLIMData::SetData(int64_t* photon_im_offset, uint32_t* photon_pixel, uint8_t* photon_chan, uint16_t* photon_time, int photon_time_div)
+{
+   if (photon_im_offset == NULL || photon_pixel == NULL || photon_time == NULL || photon_time_div < 1)
+      return ERR_INVALID_INPUT;
+
+   if (photon_chan == NULL && n_chan > 1)
+      return ERR_INVALID_INPUT;
+
+   this->photon_im_offset = photon_im_offset;
+   this->photon_pixel     = photon_pixel;
+   this->photon_chan      = photon_chan;
+   this->photon_time      = photon_time;
+   this->photon_time_div  = photon_time_div * time_bin;
+
+   data_mode = DATA_PHOTONS;
+   data_class = DATA_UINT32;
+   src_class = DATA_UINT32;
+
+   delete[] tr_buf_;
+   tr_buf_ = new float[ n_thread * n_p ]; //ok
+
+   int err = CalculateRegions<uint32_t>();
+
+   has_data = true;
+
+   return err;
+}
+
+int FLIMData::SetData(uint32_t* data)
+{
+   this->data = (void*)data;
+   data_mode = DATA_DIRECT;
+   SetDataClass(DATA_UINT32);
+
+   int err = CalculateRegions();
+
+   has_data = true;
+
+   return err;
+}
+
+
+double FLIMData::GetPhotonsPerCount()
+{
+   return smoothing_area / counts_per_photon;
+}
+
+void FLIMData::ImageDataFinished(int im)
+{
+   if (stream_data && im >= 0 && im < (int) load_pos.size() && load_pos[im] >= 0)
+      MarkCompleted(load_pos[im] % n_slot, im);
+}
+
+void FLIMData::AllImageLowerDataFinished(int im)
+{
+   if (stream_data)
+   {
+      for(int i=0; i<n_slot; i++)
+      {
+         int loaded = slot_image[i];
+         if (loaded >= 0 && loaded <= im)
+            MarkCompleted(i, loaded);
+      }
+   }
+}
+
+/**
+ * Start loading the images we're going to use in order. If load_regions is 
+ * given only images with pixels in one of these regions are loaded
+ */
+void FLIMData::StartStreaming(bool only_load_non_empty_images, const std::vector<int>& load_regions)
+{
+   if (stream_data && !streaming)
+   {
+      load_list.clear();
+      load_pos.assign(n_im_used, -1);
+
+      for(int im=0; im<n_im_used; im++)
+      {
+         bool load_image;
+
+         if (IsCached(im))
+         {
+            load_image = false;
+         }
+         else if (!load_regions.empty())
+         {
+            load_image = false;
+            for (size_t k = 0; k < load_regions.size(); k++)
+            {
+               if (GetRegionCount(im, load_regions[k]) > 0)
+               {
+                  load_image = true;
+                  break;
+               }
+            }
+         }
+         else if (only_load_non_empty_images)
+         {
+            load_image = false;
+            for (int r = 1; r < MAX_REGION; r++)
+            {
+               if (GetRegionCount(im, r) > 0)
+               {
+                  load_image = true;
+                  break;
+               }
+            }
+         }
+         else
+         {
+            load_image = true;
+         }
+
+         if (load_image) // don't try and load data if there are no regions
+         {
+            load_pos[im] = (int) load_list.size();
+            load_list.push_back(im);
+         }
+      }
+
+      int n_load = (int) load_list.size();
+
+      // In memory data (including photon lists) costs nothing to have 
+      // 'loaded' so we can mark it all as ready. For mapped data allow as many images in flight as 
+      // fit in the prefetch budget, but always enough to keep every 
+      // thread busy with one to spare
+      if (data_mode == DATA_MAPPED || data_mode == DATA_COMPRESSED || data_mode == DATA_READER)
+      {
+         double im_size = (double) src_n_t_full * n_chan * n_px * DataClassSize(src_class);
+         n_slot = (int) std::min(prefetch_limit / im_size, (double) n_load);
+         n_slot = std::max(n_slot, n_thread + 1);
+      }
+      else
+      {
+         n_slot = n_load;
+      }
+      n_slot = std::max(n_slot, 1);
+
+      AllocateSlots(n_slot);
+
+      for(int i=0; i<n_slot; i++)
+      {
+         slot_image[i] = -1;
+         slot_seq[i] = i;
+      }
+
+      next_load = 0;
+      stop_loading = false;
+
+      if (data_mode == DATA_MAPPED || data_mode == DATA_COMPRESSED || data_mode == DATA_READER)
+      {
+         int n_loader = std::min(n_loader_thread, n_load);
+         n_loader_running = n_loader;
+
+         for(int i=0; i<n_loader; i++)
+            ThreadPool::Run(StartDataLoaderThread,(void*)this);
+      }
+      else
+      {
+         for(int k=0; k<n_load; k++)
+            slot_image[k] = load_list[k];
+         
+         n_loader_running = 0;
+      }
+
+      streaming = true;
+   }
+}
+
+void FLIMData::StopStreaming()
+{
+   if (stream_data && streaming)
+   {
+      // Anything not yet loaded won't be used now
+      data_mutex.lock();
+      stop_loading = true;
+      data_mutex.unlock();
+
+      for(int i=0; i<n_slot; i++)
+         slot_cond[i].notify_all();
+
+      streaming = false;
+   }
+
+   // Wait for loader threads to finish
+   data_mutex.lock();
+   while (n_loader_running > 0)
+      loader_cond.wait(data_mutex);
+   data_mutex.unlock();
+}
+
+void FLIMData::SetBackground(float* background_image)
+{
+   this->background_image = background_image;
+   this->background_type = BG_IMAGE;
+}
+
+void FLIMData::SetBackground(float background)
+{
+   this->background_value = background * time_bin;
+   this->background_type = BG_VALUE;
+}
+
+void FLIMData::SetTVBackground(float* tvb_profile, float* tvb_I_map, float const_background)
+{
+   this->tvb_profile = tvb_profile;
+   this->tvb_I_map = tvb_I_map;
+   this->background_value = const_background * time_bin;
+
+   if (time_bin > 1)
+   {
+      rebin_tvb_profile.resize(n_meas);
+      RebinProfile(tvb_profile, &rebin_tvb_profile[0]);
+      this->tvb_profile = &rebin_tvb_profile[0];
+   }
+   this->background_type = BG_TV_IMAGE;
+}
+
+/**
+ * Calculate the steady state anisotropy, subtract the background and 
+ * scale to photons once the data for a thread is in tr_data
+ */
+void FLIMData::FinishTransform(int thread, int y0, int y1)
+{
+   float* tr_data    = tr_data_    + thread * n_p;
+   float* r_ss       = r_ss_       + thread * n_px;
+
+   for(int p=y0*n_x; p<y1*n_x; p++)
+      TransformPixel(p, tr_data + p*n_meas, n_t, false, tr_data + p*n_meas, polarisation_resolved ? r_ss + p : NULL);
+}
+
+/**
+ * Decide whether to transform only the masked pixels of an image. Without 
+ * smoothing this is never more work than transforming the whole image; with
+ * smoothing each masked pixel needs its neighbours so the mask must be sparse.
+ * When tiling there is no buffer for the whole image so we always do this
+ */
+bool FLIMData::UseMaskedTransform(int im)
+{
+   if (smoothing_factor == 0 || n_tile > 1)
+      return true;
+
+   double n_masked = (double) scan->masked_px_idx[im].size();
+   return n_masked * (2*smoothing_factor+1) < n_px;
+}
+
+/**
+ * Number of tiles each image is split into in tiled pixelwise mode, or 1
+ */
+int FLIMData::GetNumTiles()
+{
+   return n_tile;
+}
+
+/**
+ * Number of images which can be loaded at once while streaming. Only valid
+ * once StartStreaming has been called
+ */
+int FLIMData::GetNumStreamSlots()
+{
+   return stream_data ? n_slot : n_im_used;
+}
+
+/**
+ * Maximum number of pixels in a tile
+ */
+int FLIMData::GetTilePixels()
+{
+   return tile_rows * n_x;
+}
+
+/**
+ * Get the window [lo, hi] used to smooth point k of a line of length n. 
+ * The window is truncated at the edges of the image
+ */
+void FLIMData::GetSmoothingWindow(int k, int n, int& lo, int& hi)
+{
+   int s = smoothing_factor;
+
+   if (k < s)
+   {
+      lo = 0;
+      hi = k + s - 1;
+   }
+   else
+   {
+      lo = k - s;
+      hi = std::min(k + s, n - 1);
+   }
+}
+
+void FLIMData::SetImageT0Shift(double* image_t0_shift)
+{
+   this->image_t0_shift = image_t0_shift;
+}
+
+
+int FLIMData::GetRegionIndex(int im, int region)
+{
+   // If fitting globally, set im=-1 to get index of region for all datasets
+
+   if (global_mode == MODE_GLOBAL)
+         im++;
+
+   return region_idx[region + im * MAX_REGION];
+}
+
+int FLIMData::GetOutputRegionIndex(int im, int region)
+{
+   return output_region_idx[region + im * MAX_REGION];
+}
+
+int FLIMData::GetRegionPos(int im, int region)
+{
+   if (im == -1)
+      im = 0;
+
+   return region_pos[region + im * MAX_REGION];
+}
+
+int FLIMData::GetRegionCount(int im, int region)
+{
+   return region_count[region + im * MAX_REGION];
+}
+
+int FLIMData::GetImLoc(int im)
+{
+   for(int i=0; i<n_im_used; i++)
+   {
+      if (use_im[i] == im)
+         return i;
+   }
+   return -1;
+}
+
+double* FLIMData::GetT()
+{
+   return t + t_skip[0];
+}
+
+void FLIMData::SetExternalResampleIdx(int ext_n_meas_res, int* ext_resample_idx)
+{
+   use_ext_resample_idx = true;
+   this->ext_n_meas_res = ext_n_meas_res;
+   this->ext_resample_idx = ext_resample_idx;
+}
+
+
+int* FLIMData::GetResampleIdx(int thread)
+{
+   if (use_ext_resample_idx)
+      return ext_resample_idx;
+   else
+      return resample_idx + thread * n_t;
+}
+
+int FLIMData::GetResampleNumMeas(int thread)
+{
+   if (use_ext_resample_idx)
+      return ext_n_meas_res;
+   else
+      return n_meas_res[thread];
+}
+
+void FLIMData::DetermineAutoSampling(int thread, float decay[], int n_bin_min)
+{
+   float buf;
+   int idx;
+
+   if (n_chan > 1 || !use_autosampling || use_ext_resample_idx)
+   //if (data_type != DATA_TYPE_TCSPC || n_chan > 1 || !use_autosampling || use_ext_resample_idx)
+      return;
+
+   int* resample_idx = this->resample_idx + n_t * thread;
+
+   int   max_w = n_t / 5;
+   double min_c = 20.0 / smoothing_area;
+   
+   double total_count = 0;
+   
+   int last = -1;
+   for(int i=0; i<n_t; i++)
+   {
+      resample_idx[i] = 0;
+      total_count += decay[i];
+   }
+      
+   if (total_count < n_bin_min*min_c)
+   {
+      min_c = total_count / n_bin_min;
+   }
+
+   resample_idx[n_t-1] = 0;
+   float c = decay[n_t-1];
+   int w = 0;
+   int n_bin = 1;
+   for (int i=n_t-2; i>=0; i--)
+   {
+      if ( c < min_c && w < max_w )
+      {
+         c += decay[i];
+         w++;
+      }
+      else
+      {
+         c = decay[i];
+         resample_idx[i] = 1;
+         last = i;
+         w = 1;
+         n_bin++;
+      }
+   }
+
+   if ((c < min_c) && (n_bin > n_bin_min))
+      resample_idx[last] = 0;
+
+   n_meas_res[thread] = n_bin * n_chan;
+
+
+   // Now resample data provided
+   idx = 0;
+   for(int k=0; k<n_chan; k++)
+   {
+      for(int i=0; i<n_t; i++)
+      {
+         buf = decay[k*n_t + i];
+         decay[k*n_t + i] = 0;
+         decay[idx] += buf;
+         idx += resample_idx[i];
+      }
+      idx++;
+   }
+
+
+}
+
+
+int FLIMData::GetRegionData(int thread, int group, int region, int px, float* region_data, float* intensity_data, float* r_ss_data, float* acceptor_data, int* irf_idx, float* local_decay, int n_thread)
+{
+   int s = 0;
+
+   if ( global_mode == MODE_IMAGEWISE )
+   {
+      s = GetMaskedData(thread, group, region, region_data, intensity_data, r_ss_data, acceptor_data, irf_idx);
+   }
+   else if ( global_mode == MODE_GLOBAL )
+   {
+      // The region's intensities etc. start at its position in the dataset
+      int start = GetRegionPos(0, region);
+      GetGlobalRegionsData(thread, 1, &region, &region_data, intensity_data - start, r_ss_data - start, acceptor_data - start, &irf_idx, &local_decay, &s, n_thread);
+      return s;
+   }
+
+   CalculateMeanDecay(region_data, s, local_decay);
+
+   return s;
+}
+
+/**
+ * In global mode, get the data for several regions in a single pass over the 
+ * images so that each image is read and transformed only once. The data for 
+ * regions[k] goes into region_data[k] and irf_idx[k], its mean decay into 
+ * local_decay[k] and its number of pixels into region_px[k]. intensity_data, 
+ * r_ss_data and acceptor_data are indexed by position in the whole dataset.
+ * n_thread threads are used, or just thread if n_thread is 1
+ */
+void FLIMData::GetGlobalRegionsData(int thread, int n_region, const int* regions, float** region_data, float* intensity_data, float* r_ss_data, float* acceptor_data, int** irf_idx, float** local_decay, int* region_px, int n_thread)
+{
+   for(int k=0; k<n_region; k++)
+      region_px[k] = 0;
+
+   // we want dynamic with a chunk size of 1 as the data is being pulled from VM in order
+   #pragma omp parallel for schedule(dynamic, 1) num_threads(n_thread)
+   for(int i=0; i<n_im_used; i++)
+   {
+      if (!status->terminate)
+      {
+         // This thread index will only be used if we're not streaming data,
+         // make sure that we pass the right one in
+         int r_thread;
+         if (n_thread == 1)
+            r_thread = thread;
+         else
+            r_thread = omp_get_thread_num();
+
+         for(int k=0; k<n_region; k++)
+         {
+            int region = regions[k];
+            if (GetRegionCount(i, region) > 0)
+            {
+               int gpos = GetRegionPos(i, region);
+               int pos = gpos - GetRegionPos(0, region);
+               int s = GetMaskedData(r_thread, i, region, region_data[k] + pos*n_meas, intensity_data + gpos, r_ss_data + gpos, acceptor_data + gpos, irf_idx[k] + pos);
+               
+               #pragma omp atomic
+               region_px[k] += s;
+            }
+         }
+         ImageDataFinished(i);
+      }
+   }
+
+   for(int k=0; k<n_region; k++)
+      CalculateMeanDecay(region_data[k], region_px[k], local_decay[k]);
+}
+
+/**
+ * Average the s decays in region_data into local_decay
+ */
+void FLIMData::CalculateMeanDecay(float* region_data, int s, float* local_decay)
+{
+   memset(local_decay,0, n_meas * sizeof(float));
+
+   for(int i=0; i<s; i++)
+      for(int j=0; j<n_meas; j++)
+         local_decay[j] += region_data[i*n_meas + j];
+      
+   for(int j=0; j<n_meas; j++)
+      local_decay[j] /= s;
+}
+
+
+/**
+ * In pixelwise mode with in-memory data and no smoothing, the fitters can 
+ * read each decay using GetDirectDecay rather than from a copy of the region
+ */
+bool FLIMData::UseDirectDecays()
+{
+   return global_mode == MODE_PIXELWISE && data_mode == DATA_DIRECT && 
+          smoothing_factor == 0 && !polarisation_resolved && time_bin == 1;
+}
+
+/**
+ * Get the decay for the pixel with index irf_idx (as set by GetMaskedData).
+ * When no transform is required this points into the source data; otherwise
+ * the decay is transformed into buf, which must hold n_meas values
+ */
+float* FLIMData::GetDirectDecay(int irf_idx, float* buf)
+{
+   if (data_class == DATA_FLOAT)
+      return ReadDirectDecay<float>(irf_idx, buf);
+   else if (data_class == DATA_UINT32)
+      return ReadDirectDecay<uint32_t>(irf_idx, buf);
+   else if (data_class == DATA_UINT8)
+      return ReadDirectDecay<uint8_t>(irf_idx, buf);
+   else if (data_class == DATA_FLOAT16)
+      return ReadDirectDecay<float16>(irf_idx, buf);
+   else
+      return ReadDirectDecay<uint16_t>(irf_idx, buf);
+}
+
+/**
+ * Get the transformed decays for the masked pixels of an image in a region,
+ * or just those in one tile if tile >= 0. If masked_data is NULL only the 
+ * intensities, anisotropies and indices are set. The image is transformed 
+ * using n_tr_thread threads, which the caller must have reserved
+ */
+int FLIMData::GetMaskedData(int thread, int im, int region, float* masked_data, float* masked_intensity, float* masked_r_ss, float* masked_acceptor, int* irf_idx, int tile, int n_tr_thread)
+{
+   int y0 = 0, y1 = n_y;
+   if (tile >= 0)
+   {
+      y0 = tile * tile_rows;
+      y1 = std::min(y0 + tile_rows, n_y);
+   }
+   
+   int iml = im;
+   if (use_im != NULL)
+      iml = use_im[im];
+
+   mask_type* im_mask = mask + iml*n_x*n_y;
+   float*   acceptor  = acceptor_ + iml*n_x*n_y;
+
+   std::vector<int>&   px_idx = scan->masked_px_idx[im];
+   std::vector<float>& px_I   = scan->masked_px_intensity[im];
+
+   // If the transformed data was cached during the region scan it is stored
+   // for the masked pixels only, otherwise it is stored for every pixel
+   bool cached = IsCached(im);
+   bool masked_transform = !cached && UseMaskedTransform(im);
+   
+   float* tr_data = NULL;
+   float* r_ss    = NULL;
+   float16* tr_data_f16 = NULL;
+
+   if (masked_data == NULL)
+   {
+      tr_data = NULL;
+      r_ss    = NULL;
+      cached  = false;
+      masked_transform = true;
+   }
+   else if (cached)
+   {
+      if (scan->cached_data_f16[im].empty())
+         tr_data = &scan->cached_data[im][0];
+      else
+         tr_data_f16 = &scan->cached_data_f16[im][0];
+
+      r_ss    = polarisation_resolved ? &scan->cached_r_ss[im][0] : NULL;
+   }
+   else if (masked_transform)
+   {
+      // Decays are written straight into masked_data
+      tr_data = NULL;
+      r_ss    = NULL;
+
+      float* masked_r_ss_ptr = polarisation_resolved ? masked_r_ss : NULL;
+
+      if (data_class == DATA_FLOAT)
+         TransformMaskedImage<float>(thread, im, region, y0, y1, masked_data, masked_r_ss_ptr, n_tr_thread);
+      else if (data_class == DATA_UINT32)
+         TransformMaskedImage<uint32_t>(thread, im, region, y0, y1, masked_data, masked_r_ss_ptr, n_tr_thread);
+      else if (data_class == DATA_UINT8)
+         TransformMaskedImage<uint8_t>(thread, im, region, y0, y1, masked_data, masked_r_ss_ptr, n_tr_thread);
+      else if (data_class == DATA_FLOAT16)
+         TransformMaskedImage<float16>(thread, im, region, y0, y1, masked_data, masked_r_ss_ptr, n_tr_thread);
+      else
+         TransformMaskedImage<uint16_t>(thread, im, region, y0, y1, masked_data, masked_r_ss_ptr, n_tr_thread);
+   }
+   else
+   {
+      tr_data = tr_data_ + thread * n_p;
+      r_ss    = r_ss_ + thread * n_px;
+
+      if (data_class == DATA_FLOAT)
+         TransformImage<float>(thread, im, n_tr_thread);
+      else if (data_class == DATA_UINT32)
+         TransformImage<uint32_t>(thread, im, n_tr_thread);
+      else if (data_class == DATA_UINT8)
+         TransformImage<uint8_t>(thread, im, n_tr_thread);
+      else if (data_class == DATA_FLOAT16)
+         TransformImage<float16>(thread, im, n_tr_thread);
+      else
+         TransformImage<uint16_t>(thread, im, n_tr_thread);
+   }
+
+   // Store masked values
+   int s = 0;
+
+   int k0 = (int) (std::lower_bound(px_idx.begin(), px_idx.end(), y0*n_x) - px_idx.begin());
+   int k1 = (int) (std::lower_bound(px_idx.begin(), px_idx.end(), y1*n_x) - px_idx.begin());
+
+   for(int k=k0; k<k1; k++)
+   {
+      int p = px_idx[k];
+      int tr_p = cached ? k : p;
+
+      if (region < 0 || im_mask[p] == region || merge_regions)
+      {
+         masked_intensity[s] = px_I[k];
+   
+         if (has_acceptor)
+            masked_acceptor[s] = acceptor[p];
+
+         if (!masked_transform)
+         {
+            if (polarisation_resolved)
+               masked_r_ss[s] = r_ss[tr_p];
+
+            if (tr_data_f16 != NULL)
+            {
+               for(int i=0; i<n_meas; i++)
+                  masked_data[s*n_meas+i] = tr_data_f16[tr_p*n_meas+i];
+            }
+            else
+            {
+               for(int i=0; i<n_meas; i++)
+                  masked_data[s*n_meas+i] = tr_data[tr_p*n_meas+i];
+            }
+         }
+
+
+         irf_idx[s] = iml*n_px+p;
+         s++;
+      }
+   }
+
+   return s;
+}
+
+
+
+void FLIMData::ClearMapping()
+{
+   data_index.Close();
+   source_key.clear();
+
+   for(size_t i=0; i<data_files.size(); i++)
+   {
+      data_files[i]->compressed.Close();
+      delete data_files[i];
+   }
+   data_files.clear();
+}
+
+/**
+ * Get the file holding an image (indexed by position in use_im) and the
+ * index of the image in that file
+ */
+DataFile* FLIMData::GetImageFile(int im, int& file_im)
+{
+   if (use_im != NULL)
+      im = use_im[im];
+
+   // Find the last file starting at or before im; this skips empty files
+   int lo = 0;
+   int hi = (int) data_files.size() - 1;
+   while (lo < hi)
+   {
+      int mid = (lo + hi + 1) / 2;
+      if (data_files[mid]->first_im <= im)
+         lo = mid;
+      else
+         hi = mid - 1;
+   }
+
+   file_im = im - data_files[lo]->first_im;
+   return data_files[lo];
+}
+
+/**
+ * Get the file holding an image (indexed by position in use_im) and the 
+ * byte range of the image in that file
+ */
+DataFile* FLIMData::GetMappedImageRange(int im, unsigned long long& offset, unsigned long long& size)
+{
+   int file_im;
+   DataFile* df = GetImageFile(im, file_im);
+
+   int data_size = DataClassSize(src_class);
+
+   size   = (unsigned long long) src_n_t_full * n_chan * n_x * n_y * data_size;
+   offset = file_im * size + data_skip;
+
+   return df;
+}
+
+/**
+ * Bring an image into memory ahead of it being used. This is called from 
+ * the loader thread so that the page faults happen there and not on the 
+ * fitting threads
+ */
+void FLIMData::PrefetchImage(int im)
+{
+   if (data_mode != DATA_MAPPED || data_files.empty() || im < 0)
+      return;
+
+   unsigned long long offset, size;
+   DataFile* df = GetMappedImageRange(im, offset, size);
+   char* data_map_ptr = df->map_ptr;
+
+   // Only bring in the rows we'll read
+   int y0, y1;
+   GetReadRows(im, y0, y1);
+   if (y0 >= y1)
+      return;
+
+   unsigned long long row_size = size / n_y;
+   offset += y0 * row_size;
+   size = (y1 - y0) * row_size;
+
+   unsigned long long page_size = boost::interprocess::mapped_region::get_page_size();
+   unsigned long long start = offset - (offset % page_size);
+
+#ifndef _WIN32
+   madvise(data_map_ptr + start, offset + size - start, MADV_WILLNEED);
+#endif
+
+   // Touch each page to make sure it has actually been read 
+   volatile char sink = 0;
+   for(unsigned long long p=offset; p<offset+size; p+=page_size)
+      sink += data_map_ptr[p];
+   sink += data_map_ptr[offset+size-1];
+}
+
+/**
+ * Read an image (indexed by position in use_im) from a compressed 
+ * container or file reader. If we're rebinning the image is read at the 
+ * source resolution and then summed into buf. Returns an error if the 
+ * image can't be read, in which case buf doesn't hold the image
+ */
+int FLIMData::ReadImage(int im, void* buf, float* peak)
+{
+   // Only the rows we'll read are decoded
+   int y0, y1;
+   GetReadRows(im, y0, y1);
+   if (y0 >= y1)
+      return SUCCESS;
+
+   std::vector<char> src_buf;
+   void* read_buf = buf;
+   if (time_bin > 1)
+   {
+      src_buf.resize((size_t) n_px * n_chan * src_n_t_full * DataClassSize(src_class));
+      read_buf = &src_buf[0];
+   }
+
+   int err = SUCCESS;
+   if (data_mode == DATA_READER)
+   {
+      err = reader->ReadImage((use_im != NULL) ? use_im[im] : im, read_buf);
+   }
+   else
+   {
+      int file_im;
+      DataFile* df = GetImageFile(im, file_im);
+      err = df->compressed.DecodeImage(file_im, read_buf, y0*n_x, y1*n_x);
+   }
+
+   if (err != SUCCESS)
+      return err;
+
+   if (time_bin > 1)
+      RebinImage(read_buf, (float*) buf, y0*n_x, y1*n_x, 1, peak);
+
+   return SUCCESS;
+}
+
+/**
+ * Get a pointer to the source data for an image (indexed by position in use_im)
+ * in DATA_DIRECT or DATA_MAPPED mode
+ */
+void* FLIMData::GetDataPointer(int im)
+{
+   if (data_mode == DATA_MAPPED)
+   {
+      unsigned long long offset, size;
+      DataFile* df = GetMappedImageRange(im, offset, size);
+      return df->map_ptr + offset;
+   }
+
+   if (use_im != NULL)
+      im = use_im[im];
+
+   size_t im_size = (size_t) src_n_t_full * n_chan * n_x * n_y * DataClassSize(src_class);
+   return ((char*)data) + im * im_size;
+}
+
+/**
+ * Sum groups of time_bin time bins of pixels [p0, p1) of an image of source data into dst,
+ * putting the largest source bin of each pixel in peak
+ */
+void FLIMData::RebinImage(const void* src, float* dst, int p0, int p1, int n_rebin_thread, float* peak)
+{
+   if (src_class == DATA_FLOAT)
+      RebinData((const float*) src, dst, p0, p1, n_rebin_thread, peak);
+   else if (src_class == DATA_UINT32)
+      RebinData((const uint32_t*) src, dst, p0, p1, n_rebin_thread, peak);
+   else if (src_class == DATA_UINT8)
+      RebinData((const uint8_t*) src, dst, p0, p1, n_rebin_thread, peak);
+   else if (src_class == DATA_FLOAT16)
+      RebinData((const float16*) src, dst, p0, p1, n_rebin_thread, peak);
+   else
+      RebinData((const uint16_t*) src, dst, p0, p1, n_rebin_thread, peak);
+}
+
+/**
+ * Find the rows of each image holding pixels which pass the mask, so that
+ * we only need to read those rows
+ */
+void FLIMData::CalculateImageRows()
+{
+   roi_y0.assign(n_im_used, n_y);
+   roi_y1.assign(n_im_used, 0);
+
+   for(int i=0; i<n_im_used; i++)
+   {
+      int im = (use_im != NULL) ? use_im[i] : i;
+      mask_type* im_mask = mask + im*n_px;
+
+      for(int p=0; p<n_px; p++)
+      {
+         if (im_mask[p] > 0 && im_mask[p] < MAX_REGION)
+         {
+            int y = p / n_x;
+            roi_y0[i] = std::min(roi_y0[i], y);
+            roi_y1[i] = y + 1;
+         }
+      }
+   }
+}
+
+/**
+ * Get the rows [y0, y1) of an image which we need to read, i.e. the rows 
+ * holding pixels we might fit plus those within the smoothing window
+ */
+void FLIMData::GetReadRows(int im, int& y0, int& y1)
+{
+   if (im >= (int) roi_y0.size())
+   {
+      y0 = 0;
+      y1 = n_y;
+      return;
+   }
+
+   y0 = roi_y0[im];
+   y1 = roi_y1[im];
+
+   if (y0 < y1)
+   {
+      y0 = std::max(y0 - smoothing_factor, 0);
+      y1 = std::min(y1 + smoothing_factor, n_y);
+   }
+}
+
+/**
+ * Release the pages for an image we've finished with, if we're dropping behind
+ */
+void FLIMData::ReleaseImage(int im)
+{
+   if (!drop_behind || data_files.empty() || im < 0)
+      return;
+
+#ifndef _WIN32
+   unsigned long long offset, size;
+   DataFile* df = GetMappedImageRange(im, offset, size);
+
+   // Only release whole pages so we don't drop data from neighbouring images
+   unsigned long long page_size = boost::interprocess::mapped_region::get_page_size();
+   unsigned long long start = offset + page_size - 1;
+   start -= start % page_size;
+   unsigned long long end = offset + size;
+   end -= end % page_size;
+
+   if (end > start)
+      madvise(df->map_ptr + start, end - start, MADV_DONTNEED);
+
+   posix_fadvise(df->map_file.get_mapping_handle().handle, offset, size, POSIX_FADV_DONTNEED);
+#endif
+}
+
+
+
+FLIMData::~FLIMData()
+{
+   // The loader threads use the mapping and buffers below, so make sure 
+   // they have all finished before anything is freed
+   StopStreaming();
+
+   ClearMapping();
+
+   delete[] tr_data_;
+   delete[] tr_buf_;
+   delete[] tr_buf_image;
+   delete[] slot_buf_;
+   delete[] smooth_buf_;
+   delete[] support_flag_;
+
+   delete[] cur_transformed;
+   delete[] resample_idx;
+   delete[] n_meas_res;
+
+   for(int i=0; i<n_slot_alloc; i++)
+      status->RemoveConditionVariable(slot_cond+i);
+
+   delete[] slot_image;
+   delete[] slot_seq;
+   delete[] slot_cond;
+
+   delete[] t_skip;
+   delete[] region_count;
+   delete[] region_pos;
+   delete[] region_idx;
+   delete[] output_region_idx;
+
+   delete[] use_im;
+
+   if (!supplied_mask) 
+      delete[] mask;
+   
+   if (polarisation_resolved)
+      delete[] r_ss_;
+  
+   if (data_file != NULL)
+      delete[] data_file;
+
+   delete reader;
+
+}
+
+
+
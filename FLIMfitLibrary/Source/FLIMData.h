@@ -1,824 +1,1416 @@
-//=========================================================================
-//
-// Copyright (C) 2013 Imperial College London.
-// All rights reserved.
-//
-// This program is free software; you can redistribute it and/or modify
-// it under the terms of the GNU General Public License as published by
-// the Free Software Foundation; either version 2 of the License, or
-// (at your option) any later version.
-//
-// This program is distributed in the hope that it will be useful,
-// but WITHOUT ANY WARRANTY; without even the implied warranty of
-// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-// GNU General Public License for more details.
-//
-// You should have received a copy of the GNU General Public License along
-// with this program; if not, write to the Free Software Foundation, Inc.,
-// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
-//
-// This software tool was developed with support from the UK 
-// Engineering and Physical Sciences Council 
-// through  a studentship from the Institute of Chemical Biology 
-// and The Wellcome Trust through a grant entitled 
-// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
-//
-// Author : Sean Warren
-//
-//=========================================================================
-
-#ifndef _FLIMDATA_
-#define _FLIMDATA_
-
-#include <boost/interprocess/file_mapping.hpp>
-#include <boost/interprocess/mapped_region.hpp>
-#include <stdint.h>
-#include <boost/bind/bind.hpp>
-#include <boost/function.hpp>
-#include "tinythread.h"
-#include "FitStatus.h"
-
-#include "FlagDefinitions.h"
-#include "FLIMGlobalAnalysis.h"
-#include "ConcurrencyAnalysis.h"
-
-#include "omp_stub.h"
-
-#define MAX_REGION 4095
-
-#define STREAM_DATA  true
-
-using namespace boost;
-
-class FLIMData
-{
-
-public:
-
-   FLIMData(int polarisation_resolved, double g_factor, int n_im, int n_x, int n_y, int n_chan, int n_t_full, double t[], double t_int[], int t_skip[], int n_t, int data_type,
-            int* use_im, mask_type mask[], int merge_regions, int threshold, int limit, double counts_per_photon, int global_mode, int smoothing_factor, int use_autosampling, int n_thread, FitStatus* status);
-
-   int  SetData(float data[]);
-   int  SetData(uint16_t data[]);
-   int  SetData(uint32_t data[]);
-   int  SetData(char* data_file, int data_class, int data_skip);
-
-   int  SetAcceptor(float acceptor[]);
-   
-   template <typename T>
-   int CalculateRegions();
-
-   void DetermineAutoSampling(int thread, float decay[], int n_min_bin);
-
-   int GetRegionIndex(int im, int region);
-   int GetOutputRegionIndex(int im, int region);
-   int GetRegionPos(int im, int region);
-   int GetRegionCount(int im, int region);
-
-   int GetRegionData(int thread, int group, int region, int px, float* region_data, float* intensity_data, float* r_ss_data, float* acceptor_data, int* irf_idx, float* local_decay, int n_thread);
-   int GetMaskedData(int thread, int im, int region, float* masked_data, float* masked_intensity, float* masked_r_ss, float* masked_acceptor, int* irf_idx);
-
-   
-   int GetImLoc(int im);
-
-   void SetExternalResampleIdx(int ext_n_meas_res, int* ext_resample_idx);
-   int* GetResampleIdx(int thread);
-   int GetResampleNumMeas(int thread);
-
-   double* GetT();  
-
-   double GetPhotonsPerCount();
-
-   void SetBackground(float* background_image);
-   void SetBackground(float background);
-   void SetTVBackground(float* tvb_profile, float* tvb_I_map, float const_background);
-   void SetImageT0Shift(double* image_t0_shift);
-   void ClearMapping();
-   
-   void ImageDataFinished(int im);
-   void AllImageLowerDataFinished(int im);
-   void StartStreaming(bool only_load_non_empty_images = true, int load_region = -1);
-   void StopStreaming();
-
-   template <typename T>
-   void DataLoaderThread(bool only_load_non_empty_images, int load_region);
-
-
-
-   ~FLIMData();
-
-   int n_im;
-   int n_x;
-   int n_y;
-   int n_t;
-   int n_buf;
-
-   int n_chan;
-   int n_meas;
-
-   int n_px;
-   int n_p;
-
-   int n_regions_total;
-   int n_output_regions_total;
-   int data_type;
-
-   int data_skip;
-
-   int use_autosampling;
-
-   mask_type* mask;
-   int n_masked_px;
-   int merge_regions;
-
-   double* image_t0_shift;
-
-
-   int global_mode;
-
-   int smoothing_factor;
-   double smoothing_area;
-
-   int* t_skip;
-
-   double* t;
-   double* t_int;
-
-   double counts_per_photon;
-
-   int* use_im;
-   int n_im_used;
-
-   int has_acceptor;
-
-private:
-
-   template <typename T>
-   T* GetDataPointer(int thread, int im);
-
-   template <typename T>
-   void TransformImage(int thread, int im);
-
-   template <typename T>
-   int GetStreamedData(int im, int thread, T*& data);
-   
-   void MarkCompleted(int slot);
-
-   void* data;
-
-   float* tr_data_;
-   float* tr_buf_;
-   float* tr_row_buf_;
-   float* intensity_;
-   float* r_ss_;
-   float* acceptor_;
-
-   boost::interprocess::file_mapping data_map_file;
-   boost::interprocess::mapped_region* data_map_view;
-
-   char *data_file; 
-
-   int data_mode;
-   
-   int has_data;
-   int supplied_mask;
-
-   int background_type;
-   float background_value;
-   float* background_image;
-
-   float* tvb_profile;
-   float* tvb_I_map;
-
-   int n_thread;
-
-   int n_meas_full;
-
-   int n_t_full;
-
-   int threshold;
-   int limit;
-
-   int* cur_transformed;
-
-   int data_class;
-
-   int* resample_idx;
-   int* n_meas_res;
-
-   bool use_ext_resample_idx;
-   int* ext_resample_idx;
-   int ext_n_meas_res;
-
-   int polarisation_resolved;
-   double g_factor;
-
-   int* region_idx;
-   int* output_region_idx;
-   int* region_count;
-   int* region_pos;
-
-   int* data_used;
-   int* data_loaded;
-
-   bool stream_data;
-
-   tthread::thread* loader_thread;
-   tthread::mutex data_mutex;
-   tthread::condition_variable data_avail_cond;
-   tthread::condition_variable data_used_cond;
-
-   FitStatus *status;
-
-   friend void StartDataLoaderThread(void* wparams);
-
-};
-
-
-struct DataLoaderThreadParams
-{
-   FLIMData* data;
-   bool only_load_non_empty_images;
-   int load_region;
-};
-
-void StartDataLoaderThread(void* wparams);
-
-
-template <typename T>
-T* FLIMData::GetDataPointer(int thread, int im)
-{
-   using namespace boost::interprocess;
-
-   if (use_im != NULL)
-      im = use_im[im];
-   unsigned long long offset, buf_size;
-
-   unsigned long long int im_size = n_t_full * n_chan * n_x * n_y;
-
-   int data_size = sizeof(T);
-
-   T* data_ptr;
-
-   try
-   {
-      if (data_mode == DATA_MAPPED)
-      {
-         buf_size = im_size * data_size;
-         offset   = im * im_size * data_size + data_skip;
-
-         data_map_view[thread] = mapped_region(data_map_file, read_only, offset, buf_size);
-         data_ptr = (T*) data_map_view[thread].get_address();
-      }
-      else 
-      {
-         data_ptr = ((T*)data) + im * im_size;
-      }
-   }
-   catch(std::exception& e)
-   {
-      e = e;
-      data_ptr = NULL;
-   }
-
-   return data_ptr;
-}
-
-
-
-template <typename T>
-int FLIMData::CalculateRegions()
-{
-   INIT_CONCURRENCY;
-
-   int err = 0;
-
-   int cur_pos = 0;
-   
-   n_regions_total = 0;
-
-   int r_count = 0;
-   int r_idx = 0; 
-   
-   omp_set_num_threads(n_thread);
-
-   double tvb_sum = 0;
-   if (background_type == BG_TV_IMAGE)
-      for(int i=0; i<n_meas; i++)
-         tvb_sum += tvb_profile[i];
-   else
-      tvb_sum = 0;
-  
-
-   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-   START_SPAN("Loading Data");
-   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-
-   StartStreaming(false);
-
-   #pragma omp parallel for schedule(dynamic, 1)
-   for(int i=0; i<n_im_used; i++)
-   {
-      int thread = omp_get_thread_num();
-
-      int im = i;
-      if (use_im != NULL)
-            im = use_im[im];
-
-      T* cur_data_ptr;
-      int slot = GetStreamedData(i, thread, cur_data_ptr);
-
-      // We already have segmentation mask, now calculate integrated intensity
-      // and apply min intensity and max bin mask
-      //----------------------------------------------------
-      if (slot >= 0)
-      {
-         for(int p=0; p<n_px; p++)
-         {
-            T* ptr = cur_data_ptr + p*n_meas_full;
-            mask_type* mask_ptr = mask + im*n_px + p;
-            double intensity = 0;
-            for(int k=0; k<n_chan; k++)
-            {
-               for(int j=0; j<n_t_full; j++)
-               {
-                  if (limit > 0 && *ptr >= limit)
-                     *mask_ptr = 0;
-
-                  intensity += *ptr;
-                  ptr++;
-               }
-            }
-            if (background_type == BG_VALUE)
-               intensity -= background_value * n_meas_full;
-            else if (background_type == BG_IMAGE)
-               intensity -= background_image[p] * n_meas_full;
-            else if (background_type == BG_TV_IMAGE)
-               intensity -= (tvb_sum * tvb_I_map[p] + background_value * n_meas_full);
-
-            if (intensity < threshold || *mask_ptr < 0 || *mask_ptr >= MAX_REGION)
-               *mask_ptr = 0;
-
-         }
-      }
-      MarkCompleted(slot);
-   }
-
-   for(int i=0; i<n_im_used; i++)
-   {
-      int im = i;
-      if (use_im != NULL)
-            im = use_im[im];
-
-      // Determine how many regions we have in each image
-      //--------------------------------------------------------
-      int*       region_count_ptr = region_count + i * MAX_REGION;
-      mask_type* mask_ptr         = mask + im*n_px;
-
-      memset(region_count_ptr, 0, MAX_REGION*sizeof(int));
-      
-
-      if (merge_regions)
-      {
-         for(int p=0; p<n_px; p++)
-            region_count_ptr[(*(mask_ptr++)>0)]++;
-      }
-      else
-      {
-         for(int p=0; p<n_px; p++)
-            region_count_ptr[*(mask_ptr++)]++;  
-      }
-
-      // Calculate region indexes
-      for(int r=1; r<MAX_REGION; r++)
-      {
-         region_pos[ i* MAX_REGION + r ] = cur_pos;
-         cur_pos += region_count[ i * MAX_REGION + r ];
-         if (region_count[ i * MAX_REGION + r ] > 0)
-            output_region_idx[ i * MAX_REGION + r ] = r_idx++;
-      }
-
-
-   }
-   
-   n_output_regions_total = r_idx;
-
-   //Calculate global region indices
-   if (global_mode == MODE_GLOBAL)
-   {
-      cur_pos = 0;
-      r_idx = 0;
-
-      for(int j=1; j<MAX_REGION; j++)
-      {
-         r_count = 0;
-         for(int i=0; i<n_im_used; i++)
-         {
-            region_pos[ j + i* MAX_REGION ] = cur_pos;
-            cur_pos += region_count[ j + i * MAX_REGION ];
-            r_count += region_count[ j + i * MAX_REGION ];
-
-            if (region_count[ j + i * MAX_REGION ] > 0)
-               region_idx[ j + (i+1) * MAX_REGION ] = r_idx;
-         }
-
-         if (r_count > 0)
-         {
-            region_idx[ j ] = r_idx;
-            r_idx++;
-         }
-
-      }
-   }
-   else
-   {
-      for(int i=0; i<MAX_REGION*n_im_used; i++)
-         region_idx[i] = output_region_idx[i];
-   }
-   
-   n_masked_px = cur_pos;
-   n_regions_total = r_idx;
-
-   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-   END_SPAN;
-   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-
-   StopStreaming();
-
-   return err;
-
-}
-
-template <typename T>
-void FLIMData::DataLoaderThread(bool only_load_non_empty_images, int load_region)
-{
-   for(int i=0; i<n_thread; i++)
-   {
-      data_loaded[i] = -1;
-      data_used[i] = 1;
-   }
-
-   int free_slot;
-   bool load_image;
-
-   for(int im=0; im<n_im_used; im++)
-   {
-      if (load_region > -1)
-      {
-         if (GetRegionCount(im, load_region) > 0)
-            load_image = true;
-      }
-      else if (only_load_non_empty_images)
-      {
-         load_image = false;
-         for (int r = 1; r < MAX_REGION; r++)
-         {
-            if (GetRegionCount(im, r) > 0)
-            {
-               load_image = true;
-               break;
-            }
-         }
-      }
-      else
-      {
-         load_image = true;
-      }
-      if (load_image) // don't try and load data if there are no regions
-      {
-         data_mutex.lock();
-
-         // wait for some space to become free
-         do
-         {
-            free_slot = -1;
-            for(int j=0; j<n_thread; j++)
-            {
-               if (data_used[j])
-               {
-                  free_slot = j;
-                  break;
-               }
-            }   
-
-            if (status->terminate)
-               free_slot = -2;
-
-            if (free_slot == -1)
-               data_used_cond.wait(data_mutex);
-                  
-         }
-         while( free_slot == -1 );
-
-         if (free_slot >= 0)
-            data_used[free_slot] = 0;
-
-         data_mutex.unlock();
-
-         if (free_slot == -2)
-            return;
-
-         T* tr_buf = (T*) this->tr_buf_  + free_slot * n_p;
-         T* data_ptr = GetDataPointer<T>(free_slot, im);
-         memcpy(tr_buf, data_ptr, n_p * sizeof(T));
-         data_loaded[free_slot] = im;
-
-         data_avail_cond.notify_all();
-      }
-   }
-
-
-}
-
-template <typename T>
-int FLIMData::GetStreamedData(int im, int thread, T*& data)
-{
-   if (stream_data)
-   {
-    // Get data from loading thread
-      data_mutex.lock();
-
-      int slot;
-      do
-      {
-
-         slot = -1;
-         for(int j=0; j<n_thread; j++)
-         {
-            if (data_loaded[j]==im)
-            {
-               slot = j;
-               break;
-            }
-         }   
-         if (status->terminate)
-            slot = -2;
-
-         if (slot == -1)
-            data_avail_cond.wait(data_mutex);
-      }
-      while( slot == -1 );
-      data_mutex.unlock();
-
-      if (slot < 0)
-      {
-         data = NULL;
-         slot = -1;
-      }
-      else
-         data = (T*) tr_buf_  + slot * n_p;
-
-      return slot;
-
-   }
-   else
-   {
-
-      T* tr_buf = (T*) this->tr_buf_  + thread * n_p;
-      T* data_ptr = GetDataPointer<T>(thread, im);
-      memcpy(tr_buf, data_ptr, n_p * sizeof(T));
-      data = tr_buf;
-
-      return 0;
-
-   }
-}
-
-template <typename T>
-void FLIMData::TransformImage(int thread, int im)
-{
-   int idx, tr_idx;
-
-   if (im == cur_transformed[thread])
-      return;
-
-   float* tr_data    = tr_data_    + thread * n_p;
-   float* intensity  = intensity_  + thread * n_px;
-   float* r_ss       = r_ss_       + thread * n_px;
-   float* tr_row_buf = tr_row_buf_ + thread * (n_x + n_y);
-
-   T* tr_buf;
-   int slot = GetStreamedData(im, thread, tr_buf);  
-   if (slot == -1)
-      return;
-
-   T* cur_data_ptr = tr_buf;
- 
-   float photons_per_count = (float) (1/counts_per_photon);
-
-
-
-   if ( smoothing_factor == 0 )
-   {
-      float* tr_ptr = tr_data;
-      // Copy data from source to tr_data, skipping cropped time points
-      for(int y=0; y<n_y; y++)
-         for(int x=0; x<n_x; x++)
-            for(int c=0; c<n_chan; c++)
-            {
-               for(int i=0; i<n_t; i++)
-                  tr_ptr[i] = cur_data_ptr[t_skip[c]+i];
-               cur_data_ptr += n_t_full;
-               tr_ptr += n_t;
-            }
-   }
-   else
-   {
-      int s = smoothing_factor;
-
-      int dxt = n_meas; 
-      int dyt = n_x * dxt; 
-
-      int dx = n_meas_full;
-      int dy = n_x * dx; 
-
-      float* y_smoothed_buf = intensity; // use intensity as a buffer
-
-      float sa = 2*s+1;
-
-      for(int c=0; c<n_chan; c++)
-      {
-         for(int i=0; i<n_t; i++)
-         {
-            tr_idx = c*n_t + i;
-            idx = c*n_t_full + t_skip[c] + i;
-
-            //Smooth in y axis
-            for(int x=0; x<n_x; x++)
-            {
-               for(int y=0; y<s; y++)
-               {
-                  tr_row_buf[y] = 0;
-                  for(int yp=0; yp<y+s; yp++)
-                     tr_row_buf[y] += cur_data_ptr[yp*dy+x*dx+idx];
-                  tr_row_buf[y] *= (sa / (y+s));
-               }
-
-              
-               for(int y=s; y<n_y-s; y++ )
-               {
-                  tr_row_buf[y] = 0;
-                  for(int yp=y-s; yp<=y+s; yp++)
-                     tr_row_buf[y] += cur_data_ptr[yp*dy+x*dx+idx];
-               }
-
-               for(int y=n_y-s; y<n_y; y++ )
-               {
-                  tr_row_buf[y] = 0;
-                  for(int yp=y-s; yp<n_y; yp++)
-                     tr_row_buf[y] += cur_data_ptr[yp*dy+x*dx+idx];
-                  tr_row_buf[y] *= (sa / (n_y-y+s));
-               }
-
-               for(int y=0; y<n_y; y++)
-                  y_smoothed_buf[y*n_x+x] = tr_row_buf[y];
-            }
-
-            //Smooth in x axis
-            for(int y=0; y<n_y; y++)
-            {
-               for(int x=0; x<s; x++)
-               {
-                  tr_row_buf[x] = 0;
-                  for(int xp=0; xp<x+s; xp++)
-                     tr_row_buf[x] += y_smoothed_buf[y*n_x+xp];
-                  tr_row_buf[x] *= (sa / (x+s));
-               }
-
-               for(int x=s; x<n_x-s; x++)
-               {
-                  tr_row_buf[x] = 0;
-                  for(int xp=x-s; xp<=x+s; xp++)
-                     tr_row_buf[x] += y_smoothed_buf[y*n_x+xp];
-               }
-
-               for(int x=n_x-s; x<n_x; x++ )
-               {
-                  tr_row_buf[x] = 0;
-                  for(int xp=x-s; xp<n_x; xp++)
-                     tr_row_buf[x] += y_smoothed_buf[y*n_x+xp];
-                  tr_row_buf[x] *= (sa / (n_x-x+s));
-               }
-
-               for(int x=0; x<n_x; x++)
-                  tr_data[y*dyt+x*dxt+tr_idx] = tr_row_buf[x];
-
-            }
-
-         }
-      }
-   }
-   
-   float tvb_sum = 0;
-   if (background_type == BG_TV_IMAGE)
-      for(int i=0; i<n_meas; i++)
-         tvb_sum += tvb_profile[i];
-
-   
-   // Calculate intensity
-   float* intensity_ptr = intensity;
-   cur_data_ptr = (T*) tr_buf;
-   for(int p=0; p<n_px; p++)
-   {
-      *intensity_ptr = 0;
-      for(int i=0; i<n_meas_full; i++)
-         *intensity_ptr += cur_data_ptr[i];
-      cur_data_ptr += n_meas_full;
-
-      if (background_type == BG_VALUE)
-         *intensity_ptr -= background_value * n_meas_full;
-      else if (background_type == BG_IMAGE)
-         *intensity_ptr -= background_image[p] * n_meas_full;
-      else if (background_type == BG_TV_IMAGE)
-         *intensity_ptr -= (tvb_sum * tvb_I_map[p] + background_value * n_meas_full) ;
-
-      intensity_ptr++;
-   }
-
-   // Calculate Steady State Anisotropy
-   if (polarisation_resolved)
-   {
-      float para;
-      float perp;
-
-      float* r_ptr = r_ss;
-      float*  tr_data_ptr = tr_data;
-      for(int p=0; p<n_px; p++)
-      {
-         para = 0;
-         perp = 0;
-
-         for(int i=0; i<n_t; i++)
-            para += tr_data_ptr[i];
-         tr_data_ptr += n_t;
-         for(int i=0; i<n_t; i++)
-            perp += tr_data_ptr[i];
-         tr_data_ptr += n_t;
-
-         perp *= (float) g_factor;
-
-         *r_ptr = (para - perp) / (para + 2 * perp);
-
-
-         r_ptr++;
-      }
-   }
-
-
-
-
-   // Subtract background
-   if (background_type == BG_VALUE)
-   {
-      int n_tot = n_x * n_y * n_chan * n_t;
-      for(int i=0; i<n_tot; i++)
-      {
-         tr_data[i] -= background_value * smoothing_area;
-         tr_data[i] *= photons_per_count;
-      }
-   }
-   else if (background_type == BG_IMAGE)
-   {
-      int idx = 0;
-      for(int p=0; p<n_px; p++)
-         for(int i=0; i<n_meas; i++)
-         {
-            tr_data[idx] -= background_image[p] * smoothing_area;
-            tr_data[idx] *= photons_per_count;
-            idx++;
-         }
-   } 
-   else if (background_type == BG_TV_IMAGE)
-   {
-      int idx = 0;
-      for(int p=0; p<n_px; p++)
-         for(int i=0; i<n_meas; i++)
-         {
-            tr_data[idx] -= (tvb_profile[i] * tvb_I_map[p] + background_value) * smoothing_area;
-            tr_data[idx] *= photons_per_count;
-            idx++;
-         }
-   }
-   else
-   {
-      int n_tot = n_x * n_y * n_chan * n_t;
-      for(int i=0; i<n_tot; i++)
-         tr_data[i] *= photons_per_count;
-   }
-   
-
-   // Set negative values to zero
-   int n_tot = n_x * n_y * n_chan * n_t;
-   for(int i=0; i<n_tot; i++)
-   {
-      if (tr_data[i] < 0)
-         tr_data[i] = 0;
-   }
-
-   cur_transformed[thread] = im;
-
-}
-
-
-
-#endif
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+#ifndef _FLIMDATA_
+#define _FLIMDATA_
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <stdint.h>
+#include <boost/bind/bind.hpp>
+#include <boost/function.hpp>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <limits>
+#include "tinythread.h"
+#include "FitStatus.h"
+#include "CompressedData.h"
+#include "DataIndex.h"
+#include "TransformCache.h"
+#include "ThreadPool.h"
+#include "FLIMReader.h"
+#include "TransformKernel.h"
+#include "DataTypes.h"
+
+#include "FlagDefinitions.h"
+#include "FLIMGlobalAnalysis.h"
+#include "ConcurrencyAnalysis.h"
+
+#include "omp_stub.h"
+
+#define MAX_REGION 4095
+
+#define STREAM_DATA  true
+
+using namespace boost;
+
+/**
+ * A mapped data file holding images [first_im, first_im + n_im) of the 
+ * dataset, either as raw data or in a compressed container
+ */
+struct DataFile
+{
+   boost::interprocess::file_mapping map_file;
+   boost::interprocess::mapped_region map_region;
+   char* map_ptr;
+   size_t map_size;
+   CompressedData compressed;
+   int first_im;
+   int n_im;
+};
+
+class FLIMData
+{
+
+public:
+
+   FLIMData(int polarisation_resolved, double g_factor, int n_im, int n_x, int n_y, int n_chan, int n_t_full, double t[], double t_int[], int t_skip[], int n_t, int time_bin, int data_type,
+            int* use_im, mask_type mask[], int merge_regions, int threshold, int limit, double counts_per_photon, int global_mode, int smoothing_factor, int use_autosampling, int tile_px, int n_thread, FitStatus* status);
+
+   static int CheckTimeBinning(int n_chan, int n_t_full, const int t_skip[], int n_t, int time_bin);
+
+   int  SetData(float data[]);
+   int  SetData(uint16_t data[]);
+   int  SetData(uint8_t data[]);
+   int  SetData(float16 data[]);
+   int  SetData(uint32_t data[]);
+   int  SetData(char* data_file, int data_class, int data_skip);
+   int  SetData(int n_file, char** data_files, int data_class, int data_skip);
+   int  SetData(FLIMReader* reader);
+   int  SetData(int64_t* photon_im_offset, uint32_t* photon_pixel, uint8_t* photon_chan, uint16_t* photon_time, int photon_time_div);
+
+   int  SetAcceptor(float acceptor[]);
+
+   void SetCacheLimit(double cache_limit_mb);
+   int  SetCacheClass(int cache_class);
+   void SetPrefetchParams(double prefetch_limit_mb, int n_loader_thread);
+   void SetIndexFile(const char* index_file);
+   
+   template <typename T>
+   int CalculateRegions();
+
+   void DetermineAutoSampling(int thread, float decay[], int n_min_bin);
+
+   int GetRegionIndex(int im, int region);
+   int GetOutputRegionIndex(int im, int region);
+   int GetRegionPos(int im, int region);
+   int GetRegionCount(int im, int region);
+
+   int GetRegionData(int thread, int group, int region, int px, float* region_data, float* intensity_data, float* r_ss_data, float* acceptor_data, int* irf_idx, float* local_decay, int n_thread);
+   void GetGlobalRegionsData(int thread, int n_region, const int* regions, float** region_data, float* intensity_data, float* r_ss_data, float* acceptor_data, int** irf_idx, float** local_decay, int* region_px, int n_thread);
+   int GetMaskedData(int thread, int im, int region, float* masked_data, float* masked_intensity, float* masked_r_ss, float* masked_acceptor, int* irf_idx, int tile = -1, int n_tr_thread = 1);
+
+   int GetNumTiles();
+   int GetNumStreamSlots();
+   int GetTilePixels();
+
+   bool UseDirectDecays();
+   float* GetDirectDecay(int irf_idx, float* buf);
+
+   
+   int GetImLoc(int im);
+
+   void SetExternalResampleIdx(int ext_n_meas_res, int* ext_resample_idx);
+   int* GetResampleIdx(int thread);
+   int GetResampleNumMeas(int thread);
+
+   double* GetT();  
+
+   template <typename U>
+   void RebinProfile(const U* src, U* dst);
+
+   double GetPhotonsPerCount();
+
+   void SetBackground(float* background_image);
+   void SetBackground(float background);
+   void SetTVBackground(float* tvb_profile, float* tvb_I_map, float const_background);
+   void SetImageT0Shift(double* image_t0_shift);
+   void ClearMapping();
+   
+   void ImageDataFinished(int im);
+   void AllImageLowerDataFinished(int im);
+   void StartStreaming(bool only_load_non_empty_images = true, const std::vector<int>& load_regions = std::vector<int>());
+   void StopStreaming();
+
+   int GetLoadError() { return load_error; }
+
+   void DataLoaderThread();
+
+
+
+   ~FLIMData();
+
+   int n_im;
+   int n_x;
+   int n_y;
+   int n_t;
+   int n_buf;
+
+   int n_chan;
+   int n_meas;
+
+   int n_px;
+   int n_p;
+
+   int n_regions_total;
+   int n_output_regions_total;
+   int data_type;
+
+   int data_skip;
+
+   int use_autosampling;
+
+   mask_type* mask;
+   int n_masked_px;
+   int merge_regions;
+
+   double* image_t0_shift;
+
+
+   int global_mode;
+
+   int smoothing_factor;
+   double smoothing_area;
+
+   int* t_skip;
+
+   double* t;
+   double* t_int;
+
+   int time_bin;
+
+   double counts_per_photon;
+
+   int* use_im;
+   int n_im_used;
+
+   int has_acceptor;
+
+private:
+
+   void* GetDataPointer(int im);
+
+   void RebinTimepoints();
+   void SetDataClass(int src_class);
+   int  CalculateRegions();
+
+   void RebinImage(const void* src, float* dst, int p0, int p1, int n_rebin_thread, float* peak);
+
+   template <typename T>
+   void RebinData(const T* src, float* dst, int p0, int p1, int n_rebin_thread, float* peak);
+
+   void CalculateImageRows();
+   void GetReadRows(int im, int& y0, int& y1);
+
+   DataFile* GetImageFile(int im, int& file_im);
+   DataFile* GetMappedImageRange(int im, unsigned long long& offset, unsigned long long& size);
+   void PrefetchImage(int im);
+   int ReadImage(int im, void* buf, float* peak);
+   void LoadFailed(int err);
+   void* GetSlotBuffer(int slot);
+   void ReleaseImage(int im);
+
+   template <typename T>
+   void TransformImage(int thread, int im, int n_smooth_thread);
+
+   template <typename T>
+   void TransformData(int thread, T* data, int y0, int y1, int n_smooth_thread);
+
+   void FinishTransform(int thread, int y0, int y1);
+
+   template <typename T>
+   void TransformPixel(int p, T* src, int chan_stride, bool crop, float* dst, float* r_ss);
+
+   template <typename T>
+   void TransformMaskedImage(int thread, int im, int region, int y0, int y1, float* masked_data, float* masked_r_ss, int n_tr_thread);
+
+   template <typename T>
+   void TransformMaskedData(int thread, int im, T* data, int region, int y0, int y1, float* masked_data, float* masked_r_ss, int n_tr_thread);
+
+   bool UseMaskedTransform(int im);
+
+   template <typename T>
+   float* ReadDirectDecay(int irf_idx, float* buf);
+
+   template <typename T>
+   void HistogramImage(int im, T* hist, bool crop, int n_hist_thread);
+
+   template <typename T>
+   void HistogramPhoton(int64_t j, T* hist, bool crop, int n_bin, int n_px_bin);
+
+   template <typename T>
+   void AccumulateRow(double* sum, T* row, double sign);
+
+   void GetSmoothingWindow(int k, int n, int& lo, int& hi);
+
+   template <typename T>
+   int GetStreamedData(int im, int thread, T*& data, int n_load_thread, const float** src_peak = NULL);
+
+   template <typename T>
+   void ScanImages(double tvb_sum);
+
+   template <typename T>
+   void ScanImage(int i, T* data, const float* src_peak, int thread, int n_scan_thread, double tvb_sum);
+   void MaskImage(int i, const double* sum, const double* peak, double tvb_sum, int n_mask_thread);
+   std::vector<char> GetScanKey();
+   void CalculateMeanDecay(float* region_data, int s, float* local_decay);
+   void SaveScanMask();
+   void RestoreScanMask();
+   bool ScanInIndex();
+
+   bool IsCached(int im);
+   
+   void MarkCompleted(int slot, int im);
+   void AllocateSlots(int n_slot_required);
+
+   void* data;
+
+   float* tr_data_;
+   size_t tr_data_size;
+   float* tr_buf_;
+   int* tr_buf_image;
+   char* slot_buf_;
+
+   // If time_bin > 1, the peak of each pixel over the source bins of the 
+   // image in each of the tr_buf_ buffers and then each of the slots, as 
+   // the saturation limit applies to the source bins
+   std::vector<float> src_peak_;
+   size_t slot_buf_size;
+   double* smooth_buf_;
+   uint8_t* support_flag_;
+   float* r_ss_;
+   float* acceptor_;
+
+   // Each data file is mapped once; images are read directly from the 
+   // mappings. The images in the files are numbered consecutively. If the 
+   // files are much larger than physical memory we drop pages behind us 
+   // once an image has been used
+   std::vector<DataFile*> data_files;
+   bool drop_behind;
+
+   // In DATA_COMPRESSED mode the data files are compressed containers; images 
+   // are decoded into slot_buf_ by the loader threads or into tr_buf_ if 
+   // they're needed out of turn
+
+   // Sidecar index of the intensity scan of the data files, so that the data
+   // needn't be read again to calculate the masks when it's reopened. By 
+   // default the index is the first data file with a hash of the data 
+   // parameters and .idx appended
+   DataIndex data_index;
+   std::string index_file;
+   bool default_index_file;
+
+   // Identifies the data files (names, sizes and modification times) so 
+   // that scans of them can be shared through the TransformCache
+   std::vector<char> source_key;
+
+   // Used in DATA_READER mode; images are read into slot_buf_ and 
+   // tr_buf_ as in DATA_COMPRESSED mode
+   FLIMReader* reader;
+
+   // Used in DATA_PHOTONS mode; photons from image i are in the range 
+   // [photon_im_offset[i], photon_im_offset[i+1]) of the event arrays
+   int64_t*  photon_im_offset;
+   uint32_t* photon_pixel;
+   uint8_t*  photon_chan;
+   uint16_t* photon_time;
+   int       photon_time_div;
+
+   char *data_file; 
+
+   int data_mode;
+   
+   int has_data;
+   int supplied_mask;
+
+   int background_type;
+   float background_value;
+   float* background_image;
+
+   float* tvb_profile;
+   float* tvb_I_map;
+
+   int n_thread;
+
+   int n_meas_full;
+
+   int n_t_full;
+
+   // In tiled pixelwise mode images are transformed and handed out in bands
+   // of tile_rows rows, so the per-thread buffers only need to hold one band. 
+   // Otherwise tile_rows = n_y and there is a single tile
+   int tile_rows;
+   int n_tile;
+
+   // If time_bin > 1 each group of time_bin adjacent bins of the source 
+   // data is summed as it is loaded, and n_t_full, n_t, t_skip, t and t_int
+   // describe the rebinned data. The source data has src_n_t_full bins per 
+   // channel of which src_n_t are used from src_t_skip
+   int src_n_t_full;
+   int src_n_t;
+   std::vector<int> src_t_skip;
+   std::vector<double> rebin_t;
+   std::vector<double> rebin_t_int;
+   std::vector<float> rebin_tvb_profile;
+
+   int threshold;
+   int limit;
+
+   int* cur_transformed;
+
+   int data_class;
+   int src_class;
+
+   int* resample_idx;
+   int* n_meas_res;
+
+   bool use_ext_resample_idx;
+   int* ext_resample_idx;
+   int ext_n_meas_res;
+
+   int polarisation_resolved;
+   double g_factor;
+
+   int* region_idx;
+   int* output_region_idx;
+   int* region_count;
+   int* region_pos;
+
+   // Streaming: the images in load_list are loaded in order into a ring of
+   // n_slot slots, the image at position k going into slot k % n_slot once 
+   // the image previously in that slot has been released. slot_seq holds the 
+   // next position which may use each slot and slot_image the image which
+   // is ready in the slot (or -1). The depth of the ring is set by 
+   // prefetch_limit, in bytes
+   std::vector<int> load_list;
+   std::vector<int> load_pos;
+   int n_slot;
+   int n_slot_alloc;
+   int* slot_image;
+   int* slot_seq;
+   tthread::condition_variable* slot_cond;
+   int next_load;
+   bool stop_loading;
+
+   double prefetch_limit;
+   int n_loader_thread;
+   int n_loader_running;
+
+   // The first error reading an image; the fit is terminated when one occurs
+   int load_error;
+
+   // Results of the region scan, kept so that fitting does not need to 
+   // re-read the data to get the intensity or find the masked pixels. The 
+   // transformed decays (and r_ss) of the masked pixels are kept for as 
+   // many images as fit within cache_limit bytes, in cached_data_f16 if 
+   // cache_class is DATA_FLOAT16. The scan may be shared with other fits 
+   // of the same data through the TransformCache
+   std::shared_ptr<ScanData> scan;
+   int cache_class;
+
+   // Rows [roi_y0, roi_y1) of each image, indexed by position in use_im, 
+   // which hold pixels we might fit. Only these rows, and those within the
+   // smoothing window of them, are read from the source data
+   std::vector<int> roi_y0;
+   std::vector<int> roi_y1;
+   double cache_limit;
+   double cache_used;
+   tthread::mutex cache_mutex;
+
+   bool stream_data;
+
+   bool streaming;
+   tthread::mutex data_mutex;
+   tthread::condition_variable loader_cond;
+
+   FitStatus *status;
+
+   friend void StartDataLoaderThread(void* wparams);
+
+};
+
+
+void StartDataLoaderThread(void* wparams);
+
+
+/**
+ * Sum each group of time_bin adjacent time bins of pixels [p0, p1) of an 
+ * image of source data into dst, which holds n_p values. Bins at the end 
+ * of each channel which don't fill a group are dropped. The largest source
+ * bin of each pixel is put in peak, which holds n_px values
+ */
+template <typename T>
+void FLIMData::RebinData(const T* src, float* dst, int p0, int p1, int n_rebin_thread, float* peak)
+{
+   int n_src = n_chan * src_n_t_full;
+
+   #pragma omp parallel for num_threads(n_rebin_thread)
+   for(int p=p0; p<p1; p++)
+   {
+      const T* s = src + (size_t) p * n_src;
+      float*   d = dst + (size_t) p * n_meas_full;
+      float    v_max = (float) s[0];
+
+      for(int c=0; c<n_chan; c++)
+         for(int i=0; i<n_t_full; i++)
+         {
+            const T* sb = s + c*src_n_t_full + i*time_bin;
+            float v = 0;
+            for(int k=0; k<time_bin; k++)
+            {
+               float vk = (float) sb[k];
+               v_max = std::max(v_max, vk);
+               v += vk;
+            }
+            d[c*n_t_full + i] = v;
+         }
+
+      peak[p] = v_max;
+   }
+}
+
+/**
+ * Sum a profile given over the time bins used from the source data
+ * (n_chan * src_n_t values) into dst, which holds n_meas values
+ */
+template <typename U>
+void FLIMData::RebinProfile(const U* src, U* dst)
+{
+   for(int c=0; c<n_chan; c++)
+      for(int i=0; i<n_t; i++)
+      {
+         const U* sb = src + c*src_n_t + (t_skip[c] + i) * time_bin - src_t_skip[c];
+         U v = 0;
+         for(int k=0; k<time_bin; k++)
+            v += sb[k];
+         dst[c*n_t + i] = v;
+      }
+}
+
+
+template <typename T>
+int FLIMData::CalculateRegions()
+{
+   INIT_CONCURRENCY;
+
+   int err = 0;
+
+   int cur_pos = 0;
+   
+   n_regions_total = 0;
+
+   int r_count = 0;
+   int r_idx = 0; 
+   
+   omp_set_num_threads(n_thread);
+
+   double tvb_sum = 0;
+   if (background_type == BG_TV_IMAGE)
+      for(int i=0; i<n_meas; i++)
+         tvb_sum += tvb_profile[i];
+   else
+      tvb_sum = 0;
+  
+
+   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+   START_SPAN("Loading Data");
+   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+   for(int i=0; i<n_thread; i++)
+      tr_buf_image[i] = -1;
+
+   load_error = SUCCESS;
+
+   CalculateImageRows();
+
+   // If an earlier fit has scanned the same data with the same 
+   // parameters we can just use its results
+   std::vector<char> scan_key = GetScanKey();
+   std::shared_ptr<ScanData> shared_scan;
+   if (!scan_key.empty())
+      shared_scan = TransformCache::Find(scan_key);
+
+   if (shared_scan)
+   {
+      scan = shared_scan;
+      RestoreScanMask();
+   }
+   else
+   {
+      ScanImages<T>(tvb_sum);
+
+      if (load_error != SUCCESS)
+         err = load_error;
+      else if (!scan_key.empty())
+      {
+         SaveScanMask();
+         TransformCache::Store(scan_key, scan);
+      }
+   }
+
+   for(int i=0; i<n_im_used; i++)
+   {
+      int im = i;
+      if (use_im != NULL)
+            im = use_im[im];
+
+      // Determine how many regions we have in each image
+      //--------------------------------------------------------
+      int*       region_count_ptr = region_count + i * MAX_REGION;
+      mask_type* mask_ptr         = mask + im*n_px;
+
+      memset(region_count_ptr, 0, MAX_REGION*sizeof(int));
+      
+
+      if (merge_regions)
+      {
+         for(int p=0; p<n_px; p++)
+            region_count_ptr[(*(mask_ptr++)>0)]++;
+      }
+      else
+      {
+         for(int p=0; p<n_px; p++)
+            region_count_ptr[*(mask_ptr++)]++;  
+      }
+
+      // Calculate region indexes
+      for(int r=1; r<MAX_REGION; r++)
+      {
+         region_pos[ i* MAX_REGION + r ] = cur_pos;
+         cur_pos += region_count[ i * MAX_REGION + r ];
+         if (region_count[ i * MAX_REGION + r ] > 0)
+            output_region_idx[ i * MAX_REGION + r ] = r_idx++;
+      }
+
+
+   }
+   
+   n_output_regions_total = r_idx;
+
+   //Calculate global region indices
+   if (global_mode == MODE_GLOBAL)
+   {
+      cur_pos = 0;
+      r_idx = 0;
+
+      for(int j=1; j<MAX_REGION; j++)
+      {
+         r_count = 0;
+         for(int i=0; i<n_im_used; i++)
+         {
+            region_pos[ j + i* MAX_REGION ] = cur_pos;
+            cur_pos += region_count[ j + i * MAX_REGION ];
+            r_count += region_count[ j + i * MAX_REGION ];
+
+            if (region_count[ j + i * MAX_REGION ] > 0)
+               region_idx[ j + (i+1) * MAX_REGION ] = r_idx;
+         }
+
+         if (r_count > 0)
+         {
+            region_idx[ j ] = r_idx;
+            r_idx++;
+         }
+
+      }
+   }
+   else
+   {
+      for(int i=0; i<MAX_REGION*n_im_used; i++)
+         region_idx[i] = output_region_idx[i];
+   }
+   
+   n_masked_px = cur_pos;
+   n_regions_total = r_idx;
+
+   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+   END_SPAN;
+   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+   StopStreaming();
+
+   // Pixels may have been masked out by the scan
+   CalculateImageRows();
+
+   return err;
+
+}
+
+/**
+ * Scan the images we're using, from the index if possible or else by reading
+ * the data, into a new ScanData
+ */
+template <typename T>
+void FLIMData::ScanImages(double tvb_sum)
+{
+   scan = std::make_shared<ScanData>();
+   scan->masked_px_idx.assign(n_im_used, std::vector<int>());
+   scan->masked_px_intensity.assign(n_im_used, std::vector<float>());
+   scan->cached_data.assign(n_im_used, std::vector<float>());
+   scan->cached_data_f16.assign(n_im_used, std::vector<float16>());
+   scan->cached_r_ss.assign(n_im_used, std::vector<float>());
+   cache_used = 0;
+
+   // If we only have one image parallelise over the pixels instead
+   int n_scan_thread = (n_im_used == 1) ? n_thread : 1;
+
+   if (ScanInIndex())
+   {
+      #pragma omp parallel for schedule(dynamic, 1) if(n_im_used > 1)
+      for(int i=0; i<n_im_used; i++)
+      {
+         int im = (use_im != NULL) ? use_im[i] : i;
+         MaskImage(i, data_index.GetIntensity(im), data_index.GetPeak(im), tvb_sum, n_scan_thread);
+      }
+   }
+   else
+   {
+      StartStreaming(false);
+
+      #pragma omp parallel for schedule(dynamic, 1) if(n_im_used > 1)
+      for(int i=0; i<n_im_used; i++)
+      {
+         int thread = omp_get_thread_num();
+
+         T* cur_data_ptr;
+         const float* src_peak;
+         int slot = GetStreamedData(i, thread, cur_data_ptr, n_scan_thread, &src_peak);
+
+         if (slot >= 0)
+            ScanImage(i, cur_data_ptr, src_peak, thread, n_scan_thread, tvb_sum);
+
+         ImageDataFinished(i);
+      }
+
+      // The scan may have used the transform buffers
+      for(int i=0; i<n_thread; i++)
+         cur_transformed[i] = -1;
+   }
+}
+
+/**
+ * Calculate the integrated intensity and peak value of each pixel in an image, 
+ * record them in the index and apply the masks. The transformed decays of the
+ * masked pixels are retained if they fit within the cache limit. If the data
+ * has been rebinned src_peak gives the peak of each pixel over the source bins
+ */
+template <typename T>
+void FLIMData::ScanImage(int i, T* data, const float* src_peak, int thread, int n_scan_thread, double tvb_sum)
+{
+   int im = i;
+   if (use_im != NULL)
+      im = use_im[im];
+
+   mask_type* im_mask = mask + im*n_px;
+
+   std::vector<double> sum(n_px, 0.0);
+   std::vector<double> peak(n_px, 0.0);
+
+   // Only read pixels which might be fitted; the rest are already masked out
+   bool full_scan = true;
+
+   #pragma omp parallel for num_threads(n_scan_thread) reduction(&&:full_scan)
+   for(int p=0; p<n_px; p++)
+   {
+      if (im_mask[p] == 0 || im_mask[p] >= MAX_REGION)
+      {
+         full_scan = false;
+         continue;
+      }
+
+      T* ptr = data + p*n_meas_full;
+      
+      double I = 0;
+      double I_max = ptr[0];
+      for(int j=0; j<n_meas_full; j++)
+      {
+         I_max = std::max(I_max, (double) ptr[j]);
+         I += ptr[j];
+      }
+
+      sum[p]  = I;
+      peak[p] = (src_peak != NULL) ? src_peak[p] : I_max;
+   }
+
+   if (full_scan)
+      data_index.SetImage(im, &sum[0], &peak[0]);
+
+   MaskImage(i, &sum[0], &peak[0], tvb_sum, n_scan_thread);
+
+   std::vector<int>& px_idx = scan->masked_px_idx[i];
+
+   int n_masked = (int) px_idx.size();
+
+   // Keep the transformed decays if there is space in the cache
+   double value_size = (cache_class == DATA_FLOAT16) ? sizeof(float16) : sizeof(float);
+   double cache_size = (double) n_masked * (n_meas * value_size + polarisation_resolved * sizeof(float));
+   bool use_cache = false;
+
+   cache_mutex.lock();
+   if (n_masked > 0 && cache_used + cache_size <= cache_limit)
+   {
+      cache_used += cache_size;
+      use_cache = true;
+   }
+   cache_mutex.unlock();
+
+   if (use_cache)
+   {
+      // A half precision cache is filled through a float buffer
+      std::vector<float> f_buf;
+      float* cache_ptr;
+
+      if (cache_class == DATA_FLOAT16)
+      {
+         f_buf.resize(n_masked * n_meas);
+         cache_ptr = &f_buf[0];
+      }
+      else
+      {
+         scan->cached_data[i].resize(n_masked * n_meas);
+         cache_ptr = &scan->cached_data[i][0];
+      }
+
+      if (polarisation_resolved)
+         scan->cached_r_ss[i].resize(n_masked);
+
+      if (UseMaskedTransform(i))
+      {
+         float* r_ss_ptr = polarisation_resolved ? &scan->cached_r_ss[i][0] : NULL;
+         TransformMaskedData(thread, i, data, -1, 0, n_y, cache_ptr, r_ss_ptr, n_scan_thread);
+      }
+      else
+      {
+         TransformData(thread, data, roi_y0[i], roi_y1[i], n_scan_thread);
+
+         float* tr_data = tr_data_ + thread * n_p;
+         float* r_ss    = r_ss_    + thread * n_px;
+
+         for(int k=0; k<n_masked; k++)
+            memcpy(cache_ptr + k*n_meas, tr_data + px_idx[k]*n_meas, n_meas*sizeof(float));
+
+         if (polarisation_resolved)
+         {
+            for(int k=0; k<n_masked; k++)
+               scan->cached_r_ss[i][k] = r_ss[px_idx[k]];
+         }
+      }
+
+      if (cache_class == DATA_FLOAT16)
+         scan->cached_data_f16[i].assign(f_buf.begin(), f_buf.end());
+   }
+}
+
+/**
+ * Get a pointer to the data for an image. If we're streaming, wait until the
+ * loader thread has brought the image into memory. Returns -1 if the fit 
+ * has been terminated. n_load_thread threads may be used to build the 
+ * image if it has to be decoded or histogrammed here
+ */
+template <typename T>
+int FLIMData::GetStreamedData(int im, int thread, T*& data, int n_load_thread, const float** src_peak)
+{
+   if (src_peak != NULL)
+      *src_peak = NULL;
+
+   if (stream_data)
+   {
+      // Images which aren't in the load list (or were released early) 
+      // can still be read directly, just without prefetching
+      int k = (im < (int) load_pos.size()) ? load_pos[im] : -1;
+      int s = -1;
+      
+      if (k >= 0)
+      {
+         s = k % n_slot;
+
+         data_mutex.lock();
+         while (slot_image[s] != im && slot_seq[s] <= k && !status->terminate)
+            slot_cond[s].wait(data_mutex);
+         if (slot_image[s] != im)
+            s = -1;
+         data_mutex.unlock();
+      }
+
+      if (status->terminate)
+      {
+         data = NULL;
+         return -1;
+      }
+
+      if ((data_mode == DATA_COMPRESSED || data_mode == DATA_READER) && s >= 0)
+      {
+         data = (T*) GetSlotBuffer(s);
+         if (src_peak != NULL && time_bin > 1)
+            *src_peak = &src_peak_[(size_t) (n_thread + s) * n_px];
+         return 0;
+      }
+   }
+
+   if ((data_mode == DATA_DIRECT || data_mode == DATA_MAPPED) && time_bin == 1)
+   {
+      data = (T*) GetDataPointer(im);
+      return 0;
+   }
+
+   // Otherwise the image is built in tr_buf_, which we can reuse if 
+   // it already holds this image (e.g. for the next tile)
+   float* buf = tr_buf_ + thread * n_p;
+   data = (T*) buf;
+
+   // Photons are histogrammed straight into the rebinned time bins
+   float* peak = NULL;
+   if (time_bin > 1 && data_mode != DATA_PHOTONS)
+      peak = &src_peak_[(size_t) thread * n_px];
+
+   if (src_peak != NULL)
+      *src_peak = peak;
+
+   if (tr_buf_image[thread] == im)
+      return 0;
+
+   if (data_mode == DATA_COMPRESSED || data_mode == DATA_READER)
+   {
+      int err = ReadImage(im, buf, peak);
+      if (err != SUCCESS)
+      {
+         LoadFailed(err);
+         data = NULL;
+         return -1;
+      }
+   }
+   else if (data_mode == DATA_PHOTONS)
+      HistogramImage(im, (T*) buf, false, n_load_thread);
+   else
+   {
+      int y0, y1;
+      GetReadRows(im, y0, y1);
+      RebinImage(GetDataPointer(im), buf, y0*n_x, y1*n_x, n_load_thread, peak);
+   }
+
+   tr_buf_image[thread] = im;
+   return 0;
+}
+
+/**
+ * Histogram the photons from an image. If crop is set, photons in time 
+ * bins excluded by t_skip are dropped and the histogram has n_t bins per 
+ * channel, otherwise it has n_t_full bins per channel. 
+ * 
+ * With more than one thread the pixels are split into n_hist_thread blocks.
+ * The photon stream is also split between the threads, which count and 
+ * then sort their share of the photons by block; each thread then builds 
+ * the histograms for one block from the photons sorted into it. This takes
+ * three passes over the photons whatever the number of threads, and 4 bytes
+ * per photon to hold the sorted order
+ */
+template <typename T>
+void FLIMData::HistogramImage(int im, T* hist, bool crop, int n_hist_thread)
+{
+   if (use_im != NULL)
+      im = use_im[im];
+
+   int n_bin = crop ? n_t : n_t_full;
+   int n_px_bin = n_chan * n_bin;
+
+   int64_t start = photon_im_offset[im];
+   int64_t end   = photon_im_offset[im+1];
+
+   // The sorted order is held as 32 bit offsets from start
+   if (n_hist_thread <= 1 || end - start > (int64_t) std::numeric_limits<uint32_t>::max())
+   {
+      std::fill(hist, hist + (size_t) n_px * n_px_bin, T(0));
+      for(int64_t j=start; j<end; j++)
+         HistogramPhoton(j, hist, crop, n_bin, n_px_bin);
+      return;
+   }
+
+   int n_part = n_hist_thread;
+   uint32_t part_px = (n_px + n_part - 1) / n_part;
+   int64_t n_photon = end - start;
+   int64_t slice_photon = (n_photon + n_part - 1) / n_part;
+
+   // part_pos[s*n_part + b] counts the photons from slice s in block b, 
+   // and then gives where they are sorted to in order
+   std::vector<int64_t> part_pos((size_t) n_part * n_part, 0);
+   std::vector<int64_t> part_start(n_part + 1);
+   std::vector<uint32_t> order(n_photon);
+
+   #pragma omp parallel num_threads(n_part)
+   {
+      #pragma omp for schedule(static)
+      for(int sl=0; sl<n_part; sl++)
+      {
+         int64_t j0 = start + sl * slice_photon;
+         int64_t j1 = std::min(j0 + slice_photon, end);
+         int64_t* pos = &part_pos[(size_t) sl * n_part];
+         for(int64_t j=j0; j<j1; j++)
+            if (photon_pixel[j] < (uint32_t) n_px)
+               pos[photon_pixel[j] / part_px]++;
+      }
+
+      #pragma omp single
+      {
+         int64_t n = 0;
+         for(int b=0; b<n_part; b++)
+         {
+            part_start[b] = n;
+            for(int sl=0; sl<n_part; sl++)
+            {
+               int64_t c = part_pos[(size_t) sl * n_part + b];
+               part_pos[(size_t) sl * n_part + b] = n;
+               n += c;
+            }
+         }
+         part_start[n_part] = n;
+      }
+
+      #pragma omp for schedule(static)
+      for(int sl=0; sl<n_part; sl++)
+      {
+         int64_t j0 = start + sl * slice_photon;
+         int64_t j1 = std::min(j0 + slice_photon, end);
+         int64_t* pos = &part_pos[(size_t) sl * n_part];
+         for(int64_t j=j0; j<j1; j++)
+            if (photon_pixel[j] < (uint32_t) n_px)
+               order[pos[photon_pixel[j] / part_px]++] = (uint32_t) (j - start);
+      }
+
+      #pragma omp for schedule(static)
+      for(int b=0; b<n_part; b++)
+      {
+         uint32_t p0 = b * part_px;
+         uint32_t p1 = std::min(p0 + part_px, (uint32_t) n_px);
+         if (p0 < p1)
+            std::fill(hist + (size_t) p0 * n_px_bin, hist + (size_t) p1 * n_px_bin, T(0));
+
+         for(int64_t k=part_start[b]; k<part_start[b+1]; k++)
+            HistogramPhoton(start + order[k], hist, crop, n_bin, n_px_bin);
+      }
+   }
+}
+
+/**
+ * Add photon j to the histogram of its pixel, if it falls in one of the bins
+ */
+template <typename T>
+void FLIMData::HistogramPhoton(int64_t j, T* hist, bool crop, int n_bin, int n_px_bin)
+{
+   uint32_t p = photon_pixel[j];
+   if (p >= (uint32_t) n_px)
+      return;
+
+   int c = (photon_chan != NULL) ? photon_chan[j] : 0;
+   if (c >= n_chan)
+      return;
+
+   int bin = photon_time[j] / photon_time_div;
+   if (crop)
+      bin -= t_skip[c];
+
+   if (bin >= 0 && bin < n_bin)
+      hist[(size_t) p * n_px_bin + c * n_bin + bin] += 1;
+}
+
+template <typename T>
+void FLIMData::TransformImage(int thread, int im, int n_smooth_thread)
+{
+   if (im == cur_transformed[thread])
+      return;
+
+   // Without smoothing photon data can be histogrammed straight 
+   // into tr_data, dropping photons in cropped time bins
+   if (data_mode == DATA_PHOTONS && smoothing_factor == 0)
+   {
+      HistogramImage(im, tr_data_ + thread * n_p, true, n_smooth_thread);
+      FinishTransform(thread, 0, n_y);
+      cur_transformed[thread] = im;
+      return;
+   }
+
+   T* tr_buf;
+   int slot = GetStreamedData(im, thread, tr_buf, n_smooth_thread);  
+   if (slot == -1)
+      return;
+
+   TransformData(thread, tr_buf, roi_y0[im], roi_y1[im], n_smooth_thread);
+
+   cur_transformed[thread] = im;
+}
+
+/**
+ * Transform only the pixels of an image in rows [y0, y1) which will be fitted, 
+ * writing them straight into masked_data. Used instead of TransformImage when 
+ * most of the image lies outside the mask, and for each tile when tiling
+ */
+template <typename T>
+void FLIMData::TransformMaskedImage(int thread, int im, int region, int y0, int y1, float* masked_data, float* masked_r_ss, int n_tr_thread)
+{
+   T* data;
+   if (GetStreamedData(im, thread, data, n_tr_thread) == -1)
+      return;
+
+   TransformMaskedData(thread, im, data, region, y0, y1, masked_data, masked_r_ss, n_tr_thread);
+
+   // tr_data is used as scratch space for smoothing
+   cur_transformed[thread] = -1;
+}
+
+/**
+ * Transform the masked pixels in rows [y0, y1) of an image in region (or all 
+ * masked pixels if region < 0) into consecutive decays in masked_data. When 
+ * smoothing, the data is smoothed in y into tr_data for the pixels within the 
+ * smoothing window of a masked pixel, then smoothed in x for the masked pixels 
+ * only. This is done a band of tile_rows rows at a time so that tr_data only 
+ * needs to hold one band
+ */
+template <typename T>
+void FLIMData::TransformMaskedData(int thread, int im, T* data, int region, int y0, int y1, float* masked_data, float* masked_r_ss, int n_tr_thread)
+{
+   int iml = im;
+   if (use_im != NULL)
+      iml = use_im[im];
+
+   mask_type* im_mask = mask + iml*n_px;
+   std::vector<int>& px_idx = scan->masked_px_idx[im];
+
+   // px_idx is in increasing order so the pixels in the rows are contiguous
+   std::vector<int>::iterator first = std::lower_bound(px_idx.begin(), px_idx.end(), y0*n_x);
+   std::vector<int>::iterator last  = std::lower_bound(first, px_idx.end(), y1*n_x);
+
+   std::vector<int> sel;
+   sel.reserve(last - first);
+   for(std::vector<int>::iterator it=first; it!=last; it++)
+   {
+      int p = *it;
+      if (region < 0 || im_mask[p] == region || merge_regions)
+         sel.push_back(p);
+   }
+   int n_sel = (int) sel.size();
+
+   if (smoothing_factor == 0)
+   {
+      #pragma omp parallel for num_threads(n_tr_thread)
+      for(int s=0; s<n_sel; s++)
+      {
+         int p = sel[s];
+         TransformPixel(p, data + p*n_meas_full, n_t_full, true, masked_data + s*n_meas, masked_r_ss ? masked_r_ss + s : NULL);
+      }
+      return;
+   }
+
+   float*   tr_data = tr_data_      + thread * tr_data_size;
+   uint8_t* flag    = support_flag_ + thread * tile_rows * n_x;
+
+   int s0 = 0;
+   for(int b0=y0; b0<y1; b0+=tile_rows)
+   {
+      int b1 = std::min(b0 + tile_rows, y1);
+      int q0 = b0 * n_x;
+
+      int s1 = s0;
+      while(s1 < n_sel && sel[s1] < b1*n_x)
+         s1++;
+
+      // Find the pixels in the band we need smoothed in y
+      std::vector<int> support;
+      support.reserve((s1 - s0) * 2);
+      for(int s=s0; s<s1; s++)
+      {
+         int x = sel[s] % n_x;
+         int y = sel[s] / n_x;
+         int lo, hi;
+         GetSmoothingWindow(x, n_x, lo, hi);
+         for(int xs=lo; xs<=hi; xs++)
+         {
+            int q = y*n_x + xs;
+            if (!flag[q-q0])
+            {
+               flag[q-q0] = 1;
+               support.push_back(q);
+            }
+         }
+      }
+      int n_support = (int) support.size();
+
+      #pragma omp parallel num_threads(n_tr_thread)
+      {
+         int buf_idx = (n_tr_thread > 1) ? omp_get_thread_num() : thread;
+         double* sum = smooth_buf_ + buf_idx * (n_x + 1) * n_meas;
+
+         // Smooth in y; the window may extend outside the band
+         #pragma omp for
+         for(int j=0; j<n_support; j++)
+         {
+            int q = support[j];
+            int x = q % n_x;
+            int y = q / n_x;
+            int lo, hi;
+            GetSmoothingWindow(y, n_y, lo, hi);
+
+            memset(sum, 0, n_meas * sizeof(double));
+            for(int ys=lo; ys<=hi; ys++)
+            {
+               T* row = data + (ys*n_x + x)*n_meas_full;
+               for(int c=0; c<n_chan; c++)
+                  for(int i=0; i<n_t; i++)
+                     sum[c*n_t+i] += row[c*n_t_full+t_skip[c]+i];
+            }
+
+            double scale = (2*smoothing_factor+1) / (double) (hi - lo + 1);
+            float* out = tr_data + (q-q0)*n_meas;
+            for(int i=0; i<n_meas; i++)
+               out[i] = (float) (sum[i] * scale);
+         }
+
+         // Smooth in x, writing into masked_data
+         #pragma omp for
+         for(int s=s0; s<s1; s++)
+         {
+            int p = sel[s];
+            int x = p % n_x;
+            int y = p / n_x;
+            int lo, hi;
+            GetSmoothingWindow(x, n_x, lo, hi);
+
+            memset(sum, 0, n_meas * sizeof(double));
+            for(int xs=lo; xs<=hi; xs++)
+            {
+               float* col = tr_data + (y*n_x + xs - q0)*n_meas;
+               for(int i=0; i<n_meas; i++)
+                  sum[i] += col[i];
+            }
+
+            double scale = (2*smoothing_factor+1) / (double) (hi - lo + 1);
+            float* dst = masked_data + s*n_meas;
+            for(int i=0; i<n_meas; i++)
+               dst[i] = (float) (sum[i] * scale);
+
+            TransformPixel(p, dst, n_t, false, dst, masked_r_ss ? masked_r_ss + s : NULL);
+         }
+      }
+
+      for(int j=0; j<n_support; j++)
+         flag[support[j]-q0] = 0;
+
+      s0 = s1;
+   }
+}
+
+/**
+ * Add (sign = 1) or remove (sign = -1) a row of raw data from a running sum 
+ * used for smoothing, skipping cropped time points
+ */
+template <typename T>
+void FLIMData::AccumulateRow(double* sum, T* row, double sign)
+{
+   for(int x=0; x<n_x; x++)
+   {
+      for(int c=0; c<n_chan; c++)
+      {
+         T* row_ptr = row + x*n_meas_full + c*n_t_full + t_skip[c];
+         double* sum_ptr = sum + x*n_meas + c*n_t;
+         for(int i=0; i<n_t; i++)
+            sum_ptr[i] += sign * row_ptr[i];
+      }
+   }
+}
+
+/**
+ * Transform rows [y0, y1) of raw image data into tr_data for this thread, 
+ * applying smoothing, cropping, background subtraction and photon scaling.
+ * Only the rows within the smoothing window of these rows are read
+ */
+template <typename T>
+void FLIMData::TransformData(int thread, T* cur_data_ptr, int y0, int y1, int n_smooth_thread)
+{
+   float* tr_data    = tr_data_    + thread * n_p;
+
+   if ( smoothing_factor == 0 )
+   {
+      float* r_ss = r_ss_ + thread * n_px;
+
+      // Copy data from source to tr_data, skipping cropped time points, 
+      // and apply the background and scaling in the same pass
+      #pragma omp parallel for num_threads(n_smooth_thread)
+      for(int p=y0*n_x; p<y1*n_x; p++)
+         TransformPixel(p, cur_data_ptr + p*n_meas_full, n_t_full, true, tr_data + p*n_meas, polarisation_resolved ? r_ss + p : NULL);
+   }
+   else
+   {
+      int n_row = n_x * n_meas;
+
+      // Smooth in y axis, keeping a running sum of the rows in the window
+      // Each thread processes a contiguous block of rows
+      #pragma omp parallel num_threads(n_smooth_thread)
+      {
+         int team_thread = omp_get_thread_num();
+         int n_team      = omp_get_num_threads();
+         int buf_idx     = (n_smooth_thread > 1) ? team_thread : thread;
+
+         double* sum = smooth_buf_ + buf_idx * (n_x + 1) * n_meas;
+
+         int n_block = (y1 - y0 + n_team - 1) / n_team;
+         int b0 = y0 + team_thread * n_block;
+         int b1 = std::min(b0 + n_block, y1);
+
+         int lo = 0, hi = -1;
+         if (b0 < b1)
+         {
+            GetSmoothingWindow(b0, n_y, lo, hi);
+            hi = lo - 1;
+            memset(sum, 0, n_row * sizeof(double));
+         }
+
+         for(int y=b0; y<b1; y++)
+         {
+            int w_lo, w_hi;
+            GetSmoothingWindow(y, n_y, w_lo, w_hi);
+
+            while(hi < w_hi)
+               AccumulateRow(sum, cur_data_ptr + (++hi) * n_x * n_meas_full, 1.0);
+            while(lo < w_lo)
+               AccumulateRow(sum, cur_data_ptr + (lo++) * n_x * n_meas_full, -1.0);
+
+            double scale = (2*smoothing_factor+1) / (double) (w_hi - w_lo + 1);
+            float* tr_row = tr_data + y * n_row;
+            for(int j=0; j<n_row; j++)
+               tr_row[j] = (float) (sum[j] * scale);
+         }
+      }
+
+      // Smooth in x axis, in place on each row of tr_data
+      #pragma omp parallel for num_threads(n_smooth_thread)
+      for(int y=y0; y<y1; y++)
+      {
+         int buf_idx = (n_smooth_thread > 1) ? omp_get_thread_num() : thread;
+
+         double* sum = smooth_buf_ + buf_idx * (n_x + 1) * n_meas;
+         float*  row = (float*) (sum + n_meas);
+         float*  tr_row = tr_data + y * n_row;
+
+         memcpy(row, tr_row, n_row * sizeof(float));
+         memset(sum, 0, n_meas * sizeof(double));
+
+         int lo = 0, hi = -1;
+         for(int x=0; x<n_x; x++)
+         {
+            int w_lo, w_hi;
+            GetSmoothingWindow(x, n_x, w_lo, w_hi);
+
+            for(; hi < w_hi; hi++)
+            {
+               float* add_ptr = row + (hi+1) * n_meas;
+               for(int j=0; j<n_meas; j++)
+                  sum[j] += add_ptr[j];
+            }
+            for(; lo < w_lo; lo++)
+            {
+               float* sub_ptr = row + lo * n_meas;
+               for(int j=0; j<n_meas; j++)
+                  sum[j] -= sub_ptr[j];
+            }
+
+            double scale = (2*smoothing_factor+1) / (double) (w_hi - w_lo + 1);
+            float* out_ptr = tr_row + x * n_meas;
+            for(int j=0; j<n_meas; j++)
+               out_ptr[j] = (float) (sum[j] * scale);
+         }
+      }
+
+      FinishTransform(thread, y0, y1);
+   }
+}
+
+template <typename T>
+float* FLIMData::ReadDirectDecay(int irf_idx, float* buf)
+{
+   T* src = ((T*)data) + (unsigned long long int) irf_idx * n_meas_full;
+
+   // The fitters may adjust zero values in the decay, so these are copied
+   bool transform = (data_class != DATA_FLOAT) || (n_meas != n_meas_full) || 
+                    (background_type != BG_NONE) || (counts_per_photon != 1);
+   
+   for(int i=0; i<n_meas && !transform; i++)
+      transform = !(src[i] > 0);
+
+   if (!transform)
+      return (float*) src;
+
+   TransformPixel(irf_idx % n_px, src, n_t_full, true, buf, NULL);
+   return buf;
+}
+
+/**
+ * Transform the decay from pixel p into dst in a single pass: convert to float,
+ * drop time points excluded by t_skip if crop is set, subtract the background,
+ * scale to photons and set negative values to zero. Channel c of the source
+ * starts at src + c*chan_stride. If polarisation resolved, the steady state 
+ * anisotropy is calculated first. src and dst may be the same
+ */
+template <typename T>
+void FLIMData::TransformPixel(int p, T* src, int chan_stride, bool crop, float* dst, float* r_ss)
+{
+   float photons_per_count = (float) (1/counts_per_photon);
+
+   // Calculate Steady State Anisotropy
+   if (polarisation_resolved)
+   {
+      T* para_ptr = src + (crop ? t_skip[0] : 0);
+      T* perp_ptr = src + chan_stride + (crop ? t_skip[1] : 0);
+
+      float para = 0;
+      float perp = 0;
+
+      for(int i=0; i<n_t; i++)
+         para += para_ptr[i];
+      for(int i=0; i<n_t; i++)
+         perp += perp_ptr[i];
+
+      perp *= (float) g_factor;
+
+      *r_ss = (para - perp) / (para + 2 * perp);
+   }
+
+   for(int c=0; c<n_chan; c++)
+   {
+      T* s = src + c*chan_stride + (crop ? t_skip[c] : 0);
+      float* d = dst + c*n_t;
+
+      switch(background_type)
+      {
+      case BG_VALUE:
+         TransformSpan<BG_VALUE>(s, d, n_t, photons_per_count, (float) (background_value * smoothing_area));
+         break;
+      case BG_IMAGE:
+         TransformSpan<BG_IMAGE>(s, d, n_t, photons_per_count, (float) (background_image[p] * time_bin * smoothing_area));
+         break;
+      case BG_TV_IMAGE:
+         TransformSpan<BG_TV_IMAGE>(s, d, n_t, photons_per_count, background_value, tvb_profile + c*n_t, tvb_I_map[p], (float) smoothing_area);
+         break;
+      default:
+         TransformSpan<BG_NONE>(s, d, n_t, photons_per_count);
+      }
+   }
+}
+
+
+
+#endif
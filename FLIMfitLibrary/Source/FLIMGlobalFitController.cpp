@@ -1,1481 +1,1845 @@
-//=========================================================================
-//
-// Copyright (C) 2013 Imperial College London.
-// All rights reserved.
-//
-// This program is free software; you can redistribute it and/or modify
-// it under the terms of the GNU General Public License as published by
-// the Free Software Foundation; either version 2 of the License, or
-// (at your option) any later version.
-//
-// This program is distributed in the hope that it will be useful,
-// but WITHOUT ANY WARRANTY; without even the implied warranty of
-// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-// GNU General Public License for more details.
-//
-// You should have received a copy of the GNU General Public License along
-// with this program; if not, write to the Free Software Foundation, Inc.,
-// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
-//
-// This software tool was developed with support from the UK 
-// Engineering and Physical Sciences Council 
-// through  a studentship from the Institute of Chemical Biology 
-// and The Wellcome Trust through a grant entitled 
-// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
-//
-// Author : Sean Warren
-//
-//=========================================================================
-
-#ifndef FLIMGLOBALFITCONTROLLER_H_
-#define FLIMGLOBALFITCONTROLLER_H_
-
-#include "boost/math/distributions/normal.hpp"
-
-#include "FLIMGlobalFitController.h"
-#include "IRFConvolution.h"
-#include "VariableProjector.h"
-#include "MaximumLikelihoodFitter.h"
-#include "util.h"
-
-#include "tinythread.h"
-#include "omp_stub.h"
-
-#include <limits>
-#include <exception>
-#include <cmath>
-#include <algorithm>
-
-using namespace std;
-using namespace boost::interprocess;
-
-#ifdef USE_CONCURRENCY_ANALYSIS
-marker_series* writer;
-#endif
-
-
-FLIMGlobalFitController::FLIMGlobalFitController(int global_algorithm, int image_irf, 
-                                                 int n_irf, double t_irf[], double irf[], double pulse_pileup,
-                                                 double t0_image[],
-                                                 int n_exp, int n_fix, int n_decay_group, int* decay_group,
-                                                 double tau_min[], double tau_max[], 
-                                                 int estimate_initial_tau, double tau_guess[],
-                                                 int fit_beta, double fixed_beta[],
-                                                 int n_theta, int n_theta_fix, int inc_rinf, double theta_guess[],
-                                                 int fit_t0, double t0_guess, 
-                                                 int fit_offset, double offset_guess,  
-                                                 int fit_scatter, double scatter_guess,
-                                                 int fit_tvb, double tvb_guess, double tvb_profile[],
-                                                 int n_fret, int n_fret_fix, int inc_donor, double E_guess[],
-                                                 int pulsetrain_correction, double t_rep,
-                                                 int ref_reconvolution, double ref_lifetime_guess, int algorithm,
-                                                 int weighting, int calculate_errors, double conf_interval,
-                                                 int n_thread, int runAsync, int (*callback)()) :
-   global_algorithm(global_algorithm), image_irf(image_irf), n_irf(n_irf),  t_irf(t_irf), irf(irf), pulse_pileup(pulse_pileup),
-   t0_image(t0_image), n_exp(n_exp), n_fix(n_fix), n_decay_group(n_decay_group), decay_group(decay_group),
-   tau_min(tau_min), tau_max(tau_max),
-   estimate_initial_tau(estimate_initial_tau), tau_guess(tau_guess),
-   fit_beta(fit_beta), fixed_beta(fixed_beta),
-   n_theta(n_theta), n_theta_fix(n_theta_fix), inc_rinf(inc_rinf), theta_guess(theta_guess),
-   fit_t0(fit_t0), t0_guess(t0_guess), 
-   fit_offset(fit_offset), offset_guess(offset_guess), 
-   fit_scatter(fit_scatter), scatter_guess(scatter_guess), 
-   fit_tvb(fit_tvb), tvb_guess(tvb_guess), tvb_profile(tvb_profile),
-   n_fret(n_fret), n_fret_fix(n_fret_fix), inc_donor(inc_donor), E_guess(E_guess),
-   pulsetrain_correction(pulsetrain_correction), t_rep(t_rep),
-   ref_reconvolution(ref_reconvolution), ref_lifetime_guess(ref_lifetime_guess),
-   n_thread(n_thread), runAsync(runAsync), callback(callback), algorithm(algorithm),
-   weighting(weighting), calculate_errors(calculate_errors), conf_interval(conf_interval),
-   error(0), init(false), polarisation_resolved(false), has_fit(false)
-{
-
-   if (this->n_thread < 1)
-      this->n_thread = 1;
-
-   params = new WorkerParams[this->n_thread]; //ok
-   status = new FitStatus(this,this->n_thread,NULL); //ok
-
-   alf          = NULL;
-   chi2         = NULL;
-   I            = NULL;
-   r_ss         = NULL;
-   w_mean_tau   = NULL;
-   mean_tau     = NULL;
-   cur_alf      = NULL;
-   cur_irf_idx  = NULL;
-   acceptor     = NULL;
-
-   ierr         = NULL;
-   success      = NULL;
-
-   y            = NULL;
-   lin_params   = NULL;
-
-   w            = NULL;
-
-   irf_buf      = NULL;
-   t_irf_buf    = NULL;
-   exp_buf      = NULL;
-   tau_buf      = NULL;
-   beta_buf     = NULL;
-   theta_buf    = NULL;
-   adjust_buf   = NULL;
-   decay_group_buf = NULL;
-
-   irf_max      = NULL;
-   
-   lin_params_err = NULL;
-   alf_err_lower  = NULL;
-   alf_err_upper  = NULL;
-
-   chan_fact      = NULL;
-   irf_idx        = NULL;
-
-   param_names_ptr = NULL;
-
-   result_map_filename = NULL;
-   local_decay = NULL;
-   binned_decay = NULL;
-   data = NULL;
-
-   alf_local = NULL;
-   lin_local = NULL;
-
-   thread_handle = NULL;
-
-   cur_im = NULL;
-
-   lm_algorithm = 1;
-
-}
-
-int FLIMGlobalFitController::RunWorkers()
-{
-   
-   if (status->IsRunning())
-      return ERR_FIT_IN_PROGRESS;
-
-   if (!init)
-      return ERR_COULD_NOT_START_FIT;
-
-   if (status->terminate)
-      return 0;
-
-   omp_set_num_threads(n_omp_thread);
-
-   data->StartStreaming();
-   status->AddConditionVariable(&active_lock);
-
-   if (n_fitters == 1 && !runAsync)
-   {
-      params[0].controller = this;
-      params[0].thread = 0;
-
-      StartWorkerThread((void*)(params));
-   }
-   else
-   {
-      for(int thread = 0; thread < n_fitters; thread++)
-      {
-         params[thread].controller = this;
-         params[thread].thread = thread;
-      
-         thread_handle[thread] = new tthread::thread(StartWorkerThread,(void*)(params+thread)); // ok
-      }
-
-      if (!runAsync)
-      {
-         for(int thread = 0; thread < n_fitters; thread++)
-            thread_handle[thread]->join();
-
-         data->StopStreaming();
-
-         CleanupTempVars();
-         has_fit = true;
-      }
-   }
-   return 0;
-   
-}
-
-
-/**
- * Wrapper function for WorkerThread
- */
-void StartWorkerThread(void* wparams)
-{
-   WorkerParams* p = (WorkerParams*) wparams;
-
-   FLIMGlobalFitController* controller = p->controller;
-   int                      thread     = p->thread;
-
-   controller->WorkerThread(thread);
-}
-
-/**
- * Worker thread, called several times to process regions
- */
-void FLIMGlobalFitController::WorkerThread(int thread)
-{
-   int idx, region_count;
-   status->AddThread();
-
-   //=============================================================================
-   // In pixelwise mode, we process one region at a time, with all threads
-   // working on the same region. When all threads are finished working
-   // on a region, thread 0 gets the data for the next thread and processing
-   // begins again. Use active_lock to ensure processes are kept in order
-   //=============================================================================
-   if (data->global_mode == MODE_PIXELWISE)
-   {
-	  int n_active_thread = min(n_thread,data->n_px);
-      for(int im=0; im<data->n_im_used; im++)
-      {
-         for(int r=0; r<MAX_REGION; r++)
-         {
-            if (data->GetRegionIndex(im,r) > -1)
-            {
-               idx = im*MAX_REGION+r;
-
-               if (thread > 0)
-               {     
-                  // If we are not thread 0, check if thread 0 has processed
-                  // the data we need. If not, wait until it has been processed
-                  
-                  region_mutex.lock();
-
-                  while (idx > cur_region && !(status->terminate))
-                     active_lock.wait(region_mutex);
-                  
-                  threads_active++;
-                  threads_started++;
-
-                  region_mutex.unlock();
-               }
-               else
-               {                  
-                  // If we are thread 0, check to see if all threads have started & finished on current region
-                  // then request data for next region
-
-                  region_mutex.lock();
-                  
-                  while ( (threads_active > 0) ||                                  // there are threads running
-                          ((threads_started < n_active_thread) && (cur_region >= 0)) ) // not all threads have yet started up
-                     active_lock.wait(region_mutex);
-  
-                  int pos =  data->GetRegionPos(im,r);
-
-                  float* I_local        = I        + pos;
-                  float* r_ss_local     = r_ss     + pos;
-                  float* acceptor_local = acceptor + pos;
-                  
-                  data->GetMaskedData(0, im, r, y, I_local, r_ss_local, acceptor_local, irf_idx);
-                  data->ImageDataFinished(im);
-
-                  next_pixel = 0;
-                  
-                  cur_region = idx;
-
-                  threads_active++;
-                  threads_started = 1;
-                 
-                  active_lock.notify_all();
-                  region_mutex.unlock();
-
-               }
-
-               // Process every n_thread'th pixel in region
-
-               region_count = data->GetRegionCount(im,r);
-
-               int regions_per_thread = ceil((double)region_count / n_thread);
-               int j_max = min( regions_per_thread * (thread + 1), region_count );
-
-               for(int j=regions_per_thread*thread; j<j_max; j++)
-               {
-                  ProcessRegion(im, r, j, thread);
-                  
-                  // Check to see if a termination has been requested
-                  if (status->terminate)
-                  {
-                     region_mutex.lock();
-                     threads_active--;
-                     active_lock.notify_all();
-                     region_mutex.unlock();
-                     
-                     goto terminated;
-                  }
-
-               }
-
-               region_mutex.lock();
-               threads_active--;
-               active_lock.notify_all();
-               region_mutex.unlock();
-
-            }
-         }
-      }
-   }
-
-   //=============================================================================
-   // In imagewise mode, each region from each image is processed seperately. 
-   // Each thread processes every n_thread'th region in the dataset
-   //=============================================================================
-   else if (data->global_mode == MODE_IMAGEWISE)
-   {
-      int im0 = 0;
-      int process_idx = 0;
-
-processed: 
-
-         region_mutex.lock();
-         if (next_region >= data->n_regions_total)
-            process_idx = data->n_regions_total;
-         else
-            process_idx = next_region++;
-         region_mutex.unlock();
-
-         // Cycle through every region in every image
-         if (process_idx < data->n_regions_total)
-         {
-            for(int im=im0; im<data->n_im_used; im++)
-            {
-               for(int r=0; r<MAX_REGION; r++)
-               {
-                  // Get region index and process if it exists and is for this threads
-                  idx = data->GetRegionIndex(im,r);
-                  if (idx == process_idx)  // should be processed by this thread
-                  {
-                     
-
-                     region_mutex.lock();
-                     cur_im[thread] = im;
-
-                     int release_im = cur_im[0];
-                     for(int i=1; i<n_thread; i++)
-                     {
-                        if (cur_im[i] < release_im)
-                           release_im = cur_im[i];
-                     }            
-                     data->AllImageLowerDataFinished(release_im-1);
-
-                     region_mutex.unlock();
-
-                     ProcessRegion(im, r, 0, thread);
-                     
-                     im0=im;
-                     
- 
-                     goto processed;
-                  }
-            
-                  if (status->terminate)
-                     goto imagewise_terminated;
-               }
-
-
-            }
-
-         }
-
-imagewise_terminated:
-
-		   // When thread detaches make sure we release correctly
-		   region_mutex.lock();
-         cur_im[thread] = data->n_im+1;
-
-         int release_im = cur_im[0];
-         for(int i=1; i<n_thread; i++)
-         {
-         if (cur_im[i] < release_im)
-            release_im = cur_im[i];
-         }            
-         data->AllImageLowerDataFinished(release_im-1);
-         region_mutex.unlock();
-      
-   }
-
-   //=============================================================================
-   // In global mode each region is processed seperately across the images
-   // so we processes all region 1's from every image together etc
-   // Each thread processes a different region
-   //=============================================================================
-   else
-   {
-      // Cycle through regions
-      for(int r=0; r<MAX_REGION; r++)
-      {
-         idx = data->GetRegionIndex(-1,r);
-         if (idx > -1 && idx % n_thread == thread)
-            ProcessRegion(-1, r, 0, thread);
-           
-         if (status->terminate)
-            break;
-      }
-   }
-
-terminated:
-
-   int threads_running = status->RemoveThread();
-
-   // If we're the last thread running cleanup temporary variables
-   if (threads_running == 0 && runAsync)
-   {
-      for(int i = 0; i < n_fitters; i++)
-         if(i != thread && thread_handle[i]->joinable())
-            thread_handle[i]->join();
-
-      data->StopStreaming();
-      CleanupTempVars();
-   }
-}
-
-
-void FLIMGlobalFitController::SetData(FLIMData* data)
-{
-   this->data = data;
-
-   n_t = data->n_t;
-   t = data->GetT();
-}
-
-
-void FLIMGlobalFitController::SetPolarisationMode(int mode)
-{
-   if (mode == MODE_STANDARD)
-      this->polarisation_resolved = false;
-   else
-      this->polarisation_resolved = true;
-}
-
-/**
- * Determine which data should be used when we're calculating the average lifetime for an initial guess. 
- * Since we won't take the IRF into account we need to only use data after the gate is mostly closed.
- * 
- * \param idx The pixel index, used if we have a spatially varying IRF
-*/
-int FLIMGlobalFitController::DetermineMAStartPosition(int idx)
-{
-   double c;
-   int j_last = 0;
-   int start = 0;
-   
-
-   // Get reference to timepoints
-   double* t = data->GetT();
-   
-   // Get IRF for the pixel position idx
-   double *irf = this->irf_buf + idx * n_irf * n_chan;
-
-   //===================================================
-   // If we have a scatter IRF use data after cumulative sum of IRF is
-   // 95% of total sum (so we ignore any potential tail etc)
-   //===================================================
-   if (!ref_reconvolution)
-   {      
-      // Determine 95% of IRF
-      double irf_95 = 0;
-      for(int i=0; i<n_irf; i++)
-         irf_95 += irf[i];
-      irf_95 *= 0.95;
-   
-      // Cycle through IRF to find time at which cumulative IRF is 95% of sum.
-      // Once we get there, find the time gate in the data immediately after this time
-      c = 0;
-      for(int i=0; i<n_irf; i++)
-      {
-         c += irf[i];
-         if (c >= irf_95)
-         {
-            for (int j=j_last; j<data->n_t; j++)
-               if (t[j] > t_irf[i])
-               {
-                  start = j;
-                  j_last = j;
-                  break;
-               }
-            break;
-         }   
-      }
-   }
-
-   //===================================================
-   // If we have reference IRF, use data after peak of reference which should roughly
-   // correspond to end of gate
-   //===================================================
-   else
-   {
-      // Cycle through IRF, if IRF is larger then previously seen find the find the 
-      // time gate in the data immediately after this time. Repeat until end of IRF.
-      c = 0;
-      for(int i=0; i<n_irf; i++)
-      {
-         if (irf[i] > c)
-         {
-            c = irf[i];
-            for (int j=j_last; j<data->n_t; j++)
-               if (t[j] > t_irf[i])
-               {
-                  start = j;
-                  j_last = j;
-                  break;
-               }
-         }
-      }
-   }
-
-
-   return start;
-}
-
-/**
- * Estimate average lifetime of a decay as an intial guess
- */ 
-double FLIMGlobalFitController::EstimateAverageLifetime(float decay[], int p)
-{
-   double* t   = data->GetT();
-   double  tau = 0;
-   int     start;
-   
-   //if (image_irf)
-   //   start = DetermineMAStartPosition(p);
-   //else
-      start = ma_start;
-     
-   //===================================================
-   // For TCSPC data, calculate the mean arrival time and apply a correction for
-   // the data censoring (i.e. finite measurement window)
-   //===================================================
-
-   if (data->data_type == DATA_TYPE_TCSPC)
-   {
-      double t_mean = 0;
-      double  n  = 0;
-      double c;
-
-      for(int i=start; i<n_t; i++)
-      {
-         c = decay[i]-adjust_buf[i];
-         t_mean += c * (t[i] - t[start]);
-         n   += c;
-      }
-   
-      // If polarisation resolevd add perp decay using I = para + 2*g*perp
-      if (polarisation_resolved)
-      {
-         for(int i=start; i<n_t; i++)
-         {
-            t_mean += 2 * g_factor * decay[i+n_t] * (t[i] - t[start]);
-            n   += 2 * g_factor * decay[i+n_t];
-         }
-      }
-
-      t_mean = t_mean / n;
-
-      // Apply correction for measurement window
-      double T = t[n_t-1]-t[start];
-      
-      // Older iterative correction; tends to same value more slowly
-      //tau = t_mean;
-      //for(int i=0; i<10; i++)  
-      //   tau = t_mean + T / (exp(T/tau)-1);
-
-      t_mean /= T;
-      tau = t_mean;
-
-      // Newton-Raphson update
-      for(int i=0; i<3; i++)  
-      {
-         double e = exp(1/tau);
-         double iem1 = 1/(e-1);
-         tau = tau - ( - tau + t_mean + iem1 ) / ( e * iem1 * iem1 / (tau*tau) - 1 );
-      }
-      tau *= T;
-   }
-
-   //===================================================
-   // For widefield data, apply linearised model 
-   //===================================================
-
-   else
-   {
-      double sum_t  = 0;
-      double sum_t2 = 0;
-      double sum_tlnI = 0;
-      double sum_lnI = 0;
-      double dt;
-      int    N;
-
-      double log_di;
-      double* t_int = data->t_int;
-
-      N = n_t-start;
-
-      for(int i=start; i<n_t; i++)
-      {
-         dt = t[i]-t[start];
-
-         sum_t += dt;
-         sum_t2 += dt * dt;
-
-         if ((decay[i]-adjust_buf[i]) > 0)
-            log_di = log((decay[i]-adjust_buf[i])/t_int[i]);
-         else
-            log_di = 0;
-
-         sum_tlnI += dt * log_di;
-         sum_lnI  += log_di;
-
-      }
-
-      tau  = - (N * sum_t2   - sum_t * sum_t);
-      tau /=   (N * sum_tlnI - sum_t * sum_lnI);
-
-   }
-
-   return tau;
-
-}
- 
-/** 
- * Calculate g factor for polarisation resolved data
- *
- * g factor gives relative sensitivity of parallel and perpendicular channels, 
- * and so can be determined from the ratio of the IRF's for the two channels 
-*/
-double FLIMGlobalFitController::CalculateGFactor()
-{
-   if (polarisation_resolved)
-   {
-      double perp = 0;
-      double para = 0;
-      for(int i=0; i<n_irf; i++)
-      {
-         para += irf[i];
-         perp += irf[i+n_irf];
-      }
-
-      g_factor = para / perp;
-   }
-   else
-   {
-      g_factor = 1;
-   }
-
-   return g_factor;
-}
-
-
-void FLIMGlobalFitController::Init()
-{
-
-   cur_region = -1;
-   next_pixel  = 0;
-   next_region = 0;
-   threads_active = 0;
-   threads_started = 0;
-
-   cur_im = new int[n_thread];
-   memset(cur_im,0,n_thread*sizeof(int));
-
-   getting_fit    = false;
-   use_kappa      = true;
-   
-   // Validate input
-   //---------------------------------------
-   if (polarisation_resolved)
-   {
-      if (fit_beta == FIT_LOCALLY)
-         fit_beta = FIT_GLOBALLY;
-
-      if (n_fret > 0)
-         n_fret = 0;
-   }
-
-   if (n_thread < 1)
-      n_thread = 1;
-
-
-   // Set up FRET parameters
-   //---------------------------------------
-   fit_fret = (n_fret > 0) & (fit_beta != FIT_LOCALLY);
-   if (!fit_fret)
-   {
-      n_fret = 0;
-      n_fret_fix = 0;
-      inc_donor = true;
-   }
-   else
-      n_fret_fix = min(n_fret_fix,n_fret);
- 
-   n_fret_v = n_fret - n_fret_fix;
-      
-   tau_start = inc_donor ? 0 : 1;
-
-   beta_global = (fit_beta != FIT_LOCALLY);
-
-   photons_per_count = data->GetPhotonsPerCount();
-
-   // Set up polarisation resolved measurements
-   //---------------------------------------
-   if (polarisation_resolved)
-   {
-      n_chan = 2;
-      n_r = n_theta + inc_rinf;
-      n_pol_group = n_r + 1;
-
-      chan_fact = new double[ n_chan * n_pol_group ]; //free ok
-      int i;
-
-      double f = +0.00;
-
-      chan_fact[0] = 1.0/3.0- f*1.0/3.0;
-      chan_fact[1] = (1.0/3.0) + f*1.0/3.0;
-
-      for(i=1; i<n_pol_group ; i++)
-      {
-         chan_fact[i*2  ] =   2.0/3.0 - f*2.0/3.0;
-         chan_fact[i*2+1] =  -(1.0/3.0) + f*2.0/3.0;
-      }
-
-     
-   }
-   else
-   {
-      n_chan = 1;
-      n_pol_group = 1;
-      n_r = 0;
-
-      chan_fact = new double[1]; //free ok
-      chan_fact[0] = 1;
-   }
-
-   n_theta_v = n_theta - n_theta_fix;
-
-   n_meas = n_t * n_chan;
-
-   decay_group_buf = new int[n_exp];
-
-   if (beta_global)
-   {
-
-      // Check to make sure that decay groups increase
-      // contiguously from zero
-      int cur_group = 0;
-      if (decay_group != NULL)
-      {
-         for(int i=0; i<n_exp; i++)
-         {
-            if (decay_group[i] == (cur_group + 1))
-            {
-               cur_group++;
-            }
-            else if (decay_group[i] != cur_group)
-            {
-               decay_group = NULL;
-               break;
-            }
-         }
-      }
-   }
-   else
-   {
-      decay_group = NULL;
-      n_decay_group = 1;
-   }
-
-   if (decay_group == NULL)
-      for(int i=0; i<n_exp; i++)
-         decay_group_buf[i] = 0;
-   else
-      for(int i=0; i<n_exp; i++)
-         decay_group_buf[i] = decay_group[i];
-
-
-
-
-
-   // Copy IRF, padding to ensure we have an even number of points so we can 
-   // use SSE primatives in convolution
-   //------------------------------
-   int n_irf_rep;
-   
-   if (image_irf) 
-      n_irf_rep =  data->n_px;
-   else
-      n_irf_rep = 1;
-
-   int n_irf_buf = max(1 + n_thread, n_irf_rep);
-   
-   int a_n_irf = (int) ( ceil(n_irf / 2.0) * 2 );
-   int irf_size = a_n_irf * n_chan * n_irf_buf;
-   #ifdef _WIN32
-      irf_buf   = (double*) _aligned_malloc(irf_size*sizeof(double), 16);
-      t_irf_buf = (double*) _aligned_malloc(a_n_irf*sizeof(double), 16);
-   #else
-      irf_buf  = new double[irf_size]; 
-      t_irf_buf  = new double[a_n_irf]; 
-   #endif
-      
-
-   double dt = t_irf[1]-t_irf[0];
-
-    for(int j=0; j<n_irf_rep; j++)
-   {
-      int i;
-      for(i=0; i<n_irf; i++)
-      {
-         t_irf_buf[i] = t_irf[i];
-         for(int k=0; k<n_chan; k++)
-             irf_buf[j*a_n_irf*n_chan+k*a_n_irf+i] = irf[j*n_irf*n_chan+k*n_irf+i];
-      }
-      for(; i<a_n_irf; i++)
-      {
-         t_irf_buf[i] = t_irf_buf[i-1] + dt;
-         for(int k=0; k<n_chan; k++)
-            irf_buf[j*a_n_irf*n_chan+k*a_n_irf+i] = irf_buf[j*a_n_irf*n_chan+k*a_n_irf+i-1];
-      }
-   }
-
-   n_irf = a_n_irf;
-
-   
-   if (data->global_mode == MODE_GLOBAL || (data->global_mode == MODE_IMAGEWISE && data->n_px > 1))
-      algorithm = ALG_LM;
-
-   
-   if (data->global_mode == MODE_PIXELWISE)
-   {
-      status->SetNumRegion(data->n_masked_px);
-      n_fitters = min(data->n_px,n_thread);
-   }
-   else
-   {
-      status->SetNumRegion(data->n_regions_total);
-      n_fitters = min(data->n_regions_total,n_thread);
-   }
-
-   
-   if (data->n_regions_total == 0)
-   {
-      error = ERR_FOUND_NO_REGIONS;
-      return;
-   }
-
-   // Only create as many threads as there are regions if we have
-   // fewer regions than maximum allowed number of thread
-   //---------------------------------------
-
-   
-   if (n_fitters == 1)
-      n_omp_thread = n_thread;
-   else
-      n_omp_thread = 1;
-
-   thread_handle = new tthread::thread*[ n_fitters ];
-   for(int i=0; i<n_fitters; i++)
-      thread_handle[i] = NULL;
-
-   // Supplied t_rep in seconds, convert to ps
-   this->t_rep = t_rep * 1e12;
-
-   n_fret_group = n_fret + inc_donor;        // Number of decay 'groups', i.e. FRETing species + no FRET
-
-   n_v = n_exp - n_fix;                      // Number of unfixed exponentials
-   
-   n_exp_phi = (beta_global ? n_decay_group : n_exp);
-   
-   n_beta = (fit_beta == FIT_GLOBALLY) ? n_exp - n_decay_group : 0;
-   
-   nl  = n_v + n_fret_v + n_beta + n_theta_v;                                // (varp) Number of non-linear parameters to fit
-   p   = (n_v + n_beta)*n_fret_group*n_pol_group + n_exp_phi * n_fret_v + n_theta_v;    // (varp) Number of elements in INC matrix 
-   l   = n_exp_phi * n_fret_group * n_pol_group;          // (varp) Number of linear parameters
-
-   if (data->global_mode == MODE_GLOBAL)
-      s = data->n_masked_px;                              // (varp) Number of pixels (right hand sides)
-   else if (data->global_mode == MODE_IMAGEWISE)
-      s = data->n_px;
-   else
-      s = 1;
-
-   y_dim = max(s,data->n_px);
-
-   max_dim = max(n_irf,n_t);
-   max_dim = (int) (ceil(max_dim/4.0) * 4);
-
-
-   exp_dim = max_dim * n_chan;
-
-   if (ref_reconvolution == FIT_GLOBALLY) // fitting reference lifetime
-   {
-      nl++;
-      p += l;
-   }
-
-   // Check whether t0 has been specified
-   if (fit_t0 == FIT)
-   {
-      nl++;
-      p += l;
-   }
-
-   if (fit_offset == FIT_GLOBALLY)
-   {
-      nl++;
-      p++;
-   }
-
-   if (fit_scatter == FIT_GLOBALLY)
-   {
-      nl++;
-      p++;
-   }
-
-   if (fit_tvb == FIT_GLOBALLY)
-   {
-      nl++;
-      p++;
-   }
-
-   if (fit_offset == FIT_LOCALLY)
-   {
-      l++;
-   }
-
-   if (fit_scatter == FIT_LOCALLY)
-   {
-      l++;
-   }
-
-   if (fit_tvb == FIT_LOCALLY)
-   {
-      l++;
-   }
-
-   // If using MLE, need an extra non-linear scaling factor
-   if (algorithm == ALG_ML)
-   {
-      nl += l;
-   }
-
-   if (data->global_mode == MODE_GLOBAL)
-      n = data->GetResampleNumMeas(0);
-   else
-      n = n_meas;
-
-   ndim       = max( n, 2*nl+3 );
-   nmax       = n + 16; // pad to prevent false sharing   
-
-   calculate_mean_lifetimes = !beta_global && n_exp > 1;
-
-   int n_j = fit_fret ? n_fret_group : n_exp_phi;
-
-   if (!polarisation_resolved && n_j == 1)
-      lmax = l;
-   else
-      lmax = l+1; // for I, which we will compute afterwards
-
-   if (polarisation_resolved && n_theta == 2)
-      lmax += 2; // for cluster size, f_cluster
-
-   exp_buf_size = n_exp * n_fret_group * n_pol_group * exp_dim * N_EXP_BUF_ROWS;
-
-   int alf_size = (data->global_mode == MODE_PIXELWISE) ? data->n_masked_px : data->n_regions_total;
-
-   try
-   {
-      lin_params   = new float[ data->n_masked_px * lmax ]; //ok
-      chi2         = new float[ data->n_masked_px ]; //ok
-      I            = new float[ data->n_masked_px ];
-
-      if (polarisation_resolved)
-         r_ss      = new float[ data->n_masked_px ];
-
-      if (data->has_acceptor)
-         acceptor  = new float[ data->n_masked_px ];
-
-      ierr         = new int[ data->n_regions_total ];
-      success      = new float[ data->n_regions_total ];
-      alf          = new float[ alf_size * nl ]; //ok
-
-      if (calculate_errors)
-      {
-         alf_err_lower = new float[ alf_size * nl ];
-         alf_err_upper = new float[ alf_size * nl ];
-      }
-      
-      if (calculate_mean_lifetimes)
-      {
-         w_mean_tau   = new float[ data->n_masked_px ];  
-         mean_tau     = new float[ data->n_masked_px ];  
-      }
-      
-
-      alf_local    = new double[ n_fitters * nl * 3 ]; //free ok
-      y            = new float[ n_fitters * y_dim * n_meas ]; //free ok 
-      irf_idx      = new int[ n_fitters * y_dim ];
-
-	  binned_decay = new float[n_fitters * n_meas]; //ok
-	  local_decay = new float[n_fitters * n_meas]; //ok
-      lin_local    = new float[ n_fitters * lmax ]; //ok
-      w            = new float[ n_fitters * n_meas ]; //free ok
-
-      cur_alf      = new double[ n_thread * nl ]; //ok
-      cur_irf_idx  = new int[ n_thread ];
-
-      #ifdef _WIN32
-         exp_buf   = (double*) _aligned_malloc( n_thread * exp_buf_size * sizeof(double), 16 ); //ok
-       #else
-         exp_buf   = new double[n_thread * exp_buf_size];
-       #endif
-      
-      tau_buf      = new double[ n_thread * (n_fret+1) * n_exp ]; //free ok 
-      beta_buf     = new double[ n_thread * n_exp ]; //free ok
-      theta_buf    = new double[ n_thread * n_theta ]; //free ok 
-      adjust_buf   = new float[ n_meas ]; // free ok 
-
-    
-      irf_max      = new int[n_meas]; //free ok
-
-      init = true;
-   }
-   catch(std::exception e)
-   {
-      error =  ERR_OUT_OF_MEMORY;
-      CleanupTempVars();
-      CleanupResults();
-      return;
-   }
-
-   SetNaN( cur_alf, n_thread * nl );
-   
-   for(int i=0; i<n_thread; i++)
-      cur_irf_idx[i] = -1;
-
-   SetNaN(alf, alf_size * nl );
-   SetNaN(chi2, data->n_masked_px );
-   SetNaN(I, data->n_masked_px );
-   SetNaN(r_ss, data->n_masked_px );
-   SetNaN(lin_params, data->n_masked_px * lmax);
-
-   for(int i=0; i<data->n_regions_total; i++)
-   {
-      success[i] = 0;
-      ierr[i] = 0;
-   }
-
-
-   if (n_irf > 2)
-      t_g = t_irf[1] - t_irf[0];
-   else
-      t_g = 1;
-
-
-   // Check to see if gates are equally spaced
-   //---------------------------------------------
-   eq_spaced_data = true;
-   double dt0 = t[1]-t[0];
-   for(int i=2; i<n_t; i++)
-   {
-      double dt = t[i] - t[i-1];
-      if (abs(dt - dt0) > 1)
-      {
-         eq_spaced_data = false;
-         break;
-      }
-         
-   }
-
-   CalculateIRFMax(n_t,t);
-   ma_start = DetermineMAStartPosition(0);
-
-   // Create fitting objects
-   projectors.reserve(n_fitters);
-
-   int variable_phi = (image_irf || t0_image != NULL || data->image_t0_shift != NULL);
-
-   for(int i=0; i<n_fitters; i++)
-   {
-      if (algorithm == ALG_ML)
-         projectors.push_back( std::make_shared<MaximumLikelihoodFitter>(this, l, nl, n, ndim, p, t, &(status->terminate)) );
-      else
-         projectors.push_back( std::make_shared<VariableProjector>(this, s, l, nl, n, ndim, p, t, variable_phi, weighting, n_omp_thread, &(status->terminate)) );
-   }
-
-   for(int i=0; i<n_fitters; i++)
-   {
-      if (projectors[i]->err != 0)
-         error = projectors[i]->err;
-   }
-
-
-   // Select correct convolution function for data type
-   //-------------------------------------------------
-   Convolve = conv_irf;
-   ConvolveDerivative = conv_irf_deriv;
-
-   // Setup adjust buffer which will be subtracted from the data
-   SetupAdjust(0, adjust_buf, (fit_scatter == FIX) ? (float) scatter_guess : 0, 
-                              (fit_offset == FIX)  ? (float) offset_guess  : 0, 
-                              (fit_tvb == FIX)     ? (float) tvb_guess     : 0);
-
-   // Set alf indices
-   //-----------------------------
-   int idx = n_v;
-
-   if (fit_beta == FIT_GLOBALLY)
-   {
-     alf_beta_idx = idx;
-     idx += n_beta;
-   }
-
-   if (fit_fret == FIT)
-   {
-     alf_E_idx = idx;
-     idx += n_fret_v;
-   }
-
-   alf_theta_idx = idx; 
-   idx += n_theta_v;
-
-   if (ref_reconvolution == FIT_GLOBALLY)
-     alf_ref_idx = idx++;
-
-   if (fit_t0 == FIT)
-      alf_t0_idx = idx++;
-
-   if (fit_offset == FIT_GLOBALLY)
-      alf_offset_idx = idx++;
-
-  if (fit_scatter == FIT_GLOBALLY)
-      alf_scatter_idx = idx++;
-
-  if (fit_tvb == FIT_GLOBALLY)
-      alf_tvb_idx = idx++;
-
-
-   SetOutputParamNames();
-
-
-   // standard normal distribution object:
-   boost::math::normal norm;
-   conf_factor = quantile(complement(norm, 0.5*conf_interval));
-
-
-}
-
-
-void FLIMGlobalFitController::SetOutputParamNames()
-{
-   char buf[1024];
-
-   // Parameters associated with non-linear parameters (or fixed)
-
-   for(int i=0; i<n_exp; i++)
-   {
-      sprintf(buf,"tau_%i",i+1);
-      param_names.push_back(buf);
-   }
-
-   if (fit_beta != FIT_LOCALLY)
-      for(int i=0; i<n_exp; i++)
-      {
-         sprintf(buf,"beta_%i",i+1);
-         param_names.push_back(buf);
-      }
-
-   for(int i=0; i<n_fret; i++)
-   {
-      sprintf(buf,"E_%i",i+1);
-      param_names.push_back(buf);
-   }
-
-   for(int i=0; i<n_theta; i++)
-   {
-      sprintf(buf,"theta_%i",i+1);
-      param_names.push_back(buf);
-   }
-
-   if (ref_reconvolution == FIT_GLOBALLY)
-      param_names.push_back("tau_ref");
-
-   if (fit_t0 == FIT)
-      param_names.push_back("t0");
-
-   if (fit_offset == FIT_GLOBALLY)
-      param_names.push_back("offset");
-
-   if (fit_scatter == FIT_GLOBALLY)
-      param_names.push_back("scatter");
-
-   if (fit_tvb == FIT_GLOBALLY)
-      param_names.push_back("tvb");
-
-
-   n_nl_output_params = (int) param_names.size();
-
-   if (fit_offset == FIT_LOCALLY)
-      param_names.push_back("offset");
-
-   if (fit_scatter == FIT_LOCALLY)
-      param_names.push_back("scatter");
-
-   if (fit_tvb == FIT_LOCALLY)
-      param_names.push_back("tvb");
-
-   // Now that parameters that are derived from the linear parameters
-
-   if (fit_beta == FIT_LOCALLY && n_exp > 1)
-      for(int i=0; i<n_exp; i++)
-      {
-         sprintf(buf,"beta_%i",i+1);
-         param_names.push_back(buf);
-      }
-
-   if (n_decay_group > 1)
-      for(int i=0; i<n_decay_group; i++)
-      {
-         sprintf(buf,"gamma_%i",i+1);
-         param_names.push_back(buf);
-      }
-
-   if (fit_fret == FIT && inc_donor)
-   {
-      sprintf(buf,"gamma_0");
-      param_names.push_back(buf);
-   }
-
-   if (n_fret_group > 1)
-      for(int i=0; i<n_fret; i++)
-      {
-         sprintf(buf,"gamma_%i",i+1);
-         param_names.push_back(buf);
-      }
-
-   if (polarisation_resolved)
-      param_names.push_back("r_0");
-
-   for(int i=0; i<n_theta; i++)
-   {
-      sprintf(buf,"r_%i",i+1);
-      param_names.push_back(buf);
-   }
-
-   param_names.push_back("I0");
-   
-   if (polarisation_resolved && n_theta == 2)
-   {
-      param_names.push_back("N_cluster");
-      param_names.push_back("f_cluster");
-   }
-
-   // Parameters we manually calculate at the end
-   
-   param_names.push_back("I");
-
-   if ( acceptor != NULL )
-      param_names.push_back("acceptor");
-
-   if (polarisation_resolved)
-      param_names.push_back("r_ss");
-
-
-   if (calculate_mean_lifetimes)
-   {
-      param_names.push_back("mean_tau");
-      param_names.push_back("w_mean_tau");
-   }
-
-   param_names.push_back("chi2");
-
-   n_output_params = (int) param_names.size();
-
-   param_names_ptr = new const char*[n_output_params];
-
-   for(int i=0; i<n_output_params; i++)
-      param_names_ptr[i] = param_names[i].c_str();
-
-}
-
-
-FLIMGlobalFitController::~FLIMGlobalFitController()
-{
-   status->Terminate();
-
-   while (status->IsRunning()) {}
-
-   CleanupResults();
-   CleanupTempVars();
-
-   delete status;
-   delete[] params;
-
-}
-
-/** 
- * Calculate IRF values to include in convolution for each time point
- *
- * Accounts for the step function in the model - we don't want to convolve before the decay starts
-*/
-void FLIMGlobalFitController::CalculateIRFMax(int n_t, double t[])
-{
-   for(int j=0; j<n_chan; j++)
-   {
-      for(int i=0; i<n_t; i++)
-      {
-         irf_max[j*n_t+i] = 0;
-         int k=0;
-         while(k < n_irf && (t[i] - t_irf[k]) >= -1.0)
-         {
-            irf_max[j*n_t+i] = k + j*n_irf;
-            k++;
-         }
-      }
-   }
-
-}
-
-
-int FLIMGlobalFitController::GetErrorCode()
-{
-   return error;
-}
-
-void FLIMGlobalFitController::SetupAdjust(int thread, float adjust[], float scatter_adj, float offset_adj, float tvb_adj)
-{
-
-   double scale_fact[2];
-   scale_fact[0] = 1;
-   scale_fact[1] = 0;
-
-   for(int i=0; i<n_meas; i++)
-      adjust[i] = 0;
-
-   add_irf(thread, 0, 0, adjust, n_r, scale_fact);
-
-   for(int i=0; i<n_meas; i++)
-      adjust[i] = adjust[i] * scatter_adj + offset_adj;
-
-   if (tvb_profile != NULL)
-   {
-      for(int i=0; i<n_meas; i++)
-         adjust[i] += (float) (tvb_profile[i] * tvb_adj);
-   }
-
-   for(int i=0; i<n_meas; i++)
-      adjust[i] = adjust[i] *= photons_per_count;
-}
-
-
-
-void FLIMGlobalFitController::CleanupTempVars()
-{
-
-   tthread::lock_guard<tthread::recursive_mutex> guard(cleanup_mutex);
-   
-   ClearVariable(y);
-
-   for(auto p : projectors)
-      p->ReleaseResidualMemory();
-
-   //_ASSERTE(_CrtCheckMemory());
-}
-
-void FLIMGlobalFitController::CleanupResults()
-{
-
-   tthread::lock_guard<tthread::recursive_mutex> guard(cleanup_mutex);
-
-   init = false;
-      
-   ClearVariable(lin_local);
-   ClearVariable(alf_local);
-   ClearVariable(tau_buf);
-   ClearVariable(beta_buf);
-   ClearVariable(theta_buf);
-   ClearVariable(chan_fact);
-   ClearVariable(cur_alf);
-   ClearVariable(cur_irf_idx);
-
-   ClearVariable(I);
-   ClearVariable(chi2);
-   ClearVariable(alf);
-   ClearVariable(lin_params);
-   ClearVariable(ierr);
-   ClearVariable(success);
-   ClearVariable(w_mean_tau);
-   ClearVariable(mean_tau);
-   ClearVariable(r_ss);
-   ClearVariable(acceptor);
-
-   #ifdef _WIN32
-   
-      if (exp_buf != NULL)
-      {
-         _aligned_free(exp_buf);
-         exp_buf = NULL;
-      }
-      if (irf_buf != NULL)
-      {
-         _aligned_free(irf_buf);
-         irf_buf = NULL;
-      }
-      if (t_irf_buf != NULL)
-      {
-         _aligned_free(t_irf_buf);
-         t_irf_buf = NULL;
-      }
-   
-   #else
-   
-      ClearVariable(exp_buf);
-      ClearVariable(irf_buf);
-      ClearVariable(t_irf_buf);
-   
-   #endif
-
-
-      ClearVariable(irf_max);
-      ClearVariable(adjust_buf);
-      ClearVariable(local_decay);
-	  ClearVariable(binned_decay);
-	  ClearVariable(decay_group_buf);
-
-      ClearVariable(irf_idx);
-
-      ClearVariable(y);
-      ClearVariable(w);
-      
-      ClearVariable(param_names_ptr);
-
-      ClearVariable(cur_im);
-
-      if (result_map_filename != NULL)
-      {
-         remove(result_map_filename);
-         free(result_map_filename);
-         result_map_filename = NULL;
-      }
-
-      if (data != NULL)
-      {
-         delete data;
-         data = NULL;
-      }
-
-   if (thread_handle != NULL)
-   {
-      for(int i=0; i<n_fitters; i++)
-      {
-         if (thread_handle[i] != NULL)
-            delete thread_handle[i];
-      }
-      delete[] thread_handle;
-      thread_handle = NULL;
-   }
-
-     //_ASSERTE(_CrtCheckMemory());
-}
-
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+#ifndef FLIMGLOBALFITCONTROLLER_H_
+#define FLIMGLOBALFITCONTROLLER_H_
+
+#include "boost/math/distributions/normal.hpp"
+
+#include "FLIMGlobalFitController.h"
+#include "IRFConvolution.h"
+#include "VariableProjector.h"
+#include "MaximumLikelihoodFitter.h"
+#include "util.h"
+
+#include "tinythread.h"
+#include "ThreadPool.h"
+#include "omp_stub.h"
+
+#include <limits>
+#include <exception>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+using namespace boost::interprocess;
+
+#ifdef USE_CONCURRENCY_ANALYSIS
+marker_series* writer;
+#endif
+
+
+FLIMGlobalFitController::FLIMGlobalFitController(int global_algorithm, int image_irf, 
+                                                 int n_irf, double t_irf[], double irf[], double pulse_pileup,
+                                                 double t0_image[],
+                                                 int n_exp, int n_fix, int n_decay_group, int* decay_group,
+                                                 double tau_min[], double tau_max[], 
+                                                 int estimate_initial_tau, double tau_guess[],
+                                                 int fit_beta, double fixed_beta[],
+                                                 int n_theta, int n_theta_fix, int inc_rinf, double theta_guess[],
+                                                 int fit_t0, double t0_guess, 
+                                                 int fit_offset, double offset_guess,  
+                                                 int fit_scatter, double scatter_guess,
+                                                 int fit_tvb, double tvb_guess, double tvb_profile[],
+                                                 int n_fret, int n_fret_fix, int inc_donor, double E_guess[],
+                                                 int pulsetrain_correction, double t_rep,
+                                                 int ref_reconvolution, double ref_lifetime_guess, int algorithm,
+                                                 int weighting, int calculate_errors, double conf_interval,
+                                                 int n_thread, int runAsync, int (*callback)()) :
+   global_algorithm(global_algorithm), image_irf(image_irf), n_irf(n_irf),  t_irf(t_irf), irf(irf), pulse_pileup(pulse_pileup),
+   t0_image(t0_image), n_exp(n_exp), n_fix(n_fix), n_decay_group(n_decay_group), decay_group(decay_group),
+   tau_min(tau_min), tau_max(tau_max),
+   estimate_initial_tau(estimate_initial_tau), tau_guess(tau_guess),
+   fit_beta(fit_beta), fixed_beta(fixed_beta),
+   n_theta(n_theta), n_theta_fix(n_theta_fix), inc_rinf(inc_rinf), theta_guess(theta_guess),
+   fit_t0(fit_t0), t0_guess(t0_guess), 
+   fit_offset(fit_offset), offset_guess(offset_guess), 
+   fit_scatter(fit_scatter), scatter_guess(scatter_guess), 
+   fit_tvb(fit_tvb), tvb_guess(tvb_guess), tvb_profile(tvb_profile), src_tvb_profile(tvb_profile), time_bin(1), tile_px(0),
+   n_fret(n_fret), n_fret_fix(n_fret_fix), inc_donor(inc_donor), E_guess(E_guess),
+   pulsetrain_correction(pulsetrain_correction), t_rep(t_rep),
+   ref_reconvolution(ref_reconvolution), ref_lifetime_guess(ref_lifetime_guess),
+   n_thread(n_thread), runAsync(runAsync), callback(callback), algorithm(algorithm),
+   weighting(weighting), calculate_errors(calculate_errors), conf_interval(conf_interval),
+   error(0), init(false), polarisation_resolved(false), has_fit(false)
+{
+
+   if (this->n_thread < 1)
+      this->n_thread = 1;
+
+   params = new WorkerParams[this->n_thread]; //ok
+   status = new FitStatus(this,this->n_thread,NULL); //ok
+
+   alf          = NULL;
+   chi2         = NULL;
+   I            = NULL;
+   r_ss         = NULL;
+   w_mean_tau   = NULL;
+   mean_tau     = NULL;
+   cur_alf      = NULL;
+   cur_irf_idx  = NULL;
+   acceptor     = NULL;
+
+   ierr         = NULL;
+   success      = NULL;
+
+   y            = NULL;
+   direct_y     = false;
+   lin_params   = NULL;
+
+   w            = NULL;
+
+   irf_buf      = NULL;
+   t_irf_buf    = NULL;
+   exp_buf      = NULL;
+   tau_buf      = NULL;
+   beta_buf     = NULL;
+   theta_buf    = NULL;
+   adjust_buf   = NULL;
+   decay_group_buf = NULL;
+
+   irf_max      = NULL;
+   
+   lin_params_err = NULL;
+   alf_err_lower  = NULL;
+   alf_err_upper  = NULL;
+
+   chan_fact      = NULL;
+   irf_idx        = NULL;
+
+   param_names_ptr = NULL;
+
+   result_map_filename = NULL;
+   local_decay = NULL;
+   binned_decay = NULL;
+   data = NULL;
+
+   alf_local = NULL;
+   lin_local = NULL;
+
+   n_worker_running = 0;
+   job_threads = 0;
+
+   im_tasks_left = NULL;
+
+   lm_algorithm = 1;
+
+}
+
+int FLIMGlobalFitController::RunWorkers()
+{
+   
+   if (status->IsRunning())
+      return ERR_FIT_IN_PROGRESS;
+
+   if (!init)
+      return ERR_COULD_NOT_START_FIT;
+
+   if (status->terminate)
+      return 0;
+
+   // In global mode only load the images needed for the first wave of regions
+   if (data->global_mode == MODE_GLOBAL)
+   {
+      SetupGlobalRegions();
+
+      std::vector<int> regions;
+      GetWaveRegions(0, regions);
+      data->StartStreaming(true, regions);
+   }
+   else
+   {
+      if (data->global_mode == MODE_PIXELWISE)
+         SetupPixelUnits();
+
+      data->StartStreaming();
+
+      // The order of the regions depends on how many images can be streamed
+      if (data->global_mode == MODE_IMAGEWISE)
+         SetupRegionTasks();
+   }
+   status->AddConditionVariable(&active_lock);
+
+   SetupThreads(n_fitters);
+   ThreadPool::StartJob(n_fitters, job_threads);
+
+   n_worker_running = n_fitters;
+
+   if (n_fitters == 1 && !runAsync)
+   {
+      params[0].controller = this;
+      params[0].thread = 0;
+
+      StartWorkerThread((void*)(params));
+   }
+   else
+   {
+      for(int thread = 0; thread < n_fitters; thread++)
+      {
+         params[thread].controller = this;
+         params[thread].thread = thread;
+      
+         ThreadPool::Run(StartWorkerThread,(void*)(params+thread),thread);
+      }
+
+      if (!runAsync)
+      {
+         worker_mutex.lock();
+         while (n_worker_running > 0)
+            worker_cond.wait(worker_mutex);
+         worker_mutex.unlock();
+
+         data->StopStreaming();
+
+         CleanupTempVars();
+         has_fit = true;
+      }
+   }
+
+   // Images which couldn't be read when fitting synchronously
+   return runAsync ? 0 : data->GetLoadError();
+   
+}
+
+
+/**
+ * Order regions from the most to the least costly
+ */
+static bool CompareRegionCost(const RegionTask& a, const RegionTask& b)
+{
+   return a.cost > b.cost;
+}
+
+/**
+ * Estimate the relative cost of fitting a region of an image, or of every
+ * image if im is -1. The number of points fitted and the number of nonlinear
+ * parameters are the same for every region of a fit so this only orders the 
+ * regions of one fit
+ */
+double FLIMGlobalFitController::EstimateRegionCost(int im, int region)
+{
+   double count = 0;
+
+   if (im == -1)
+   {
+      for(int i=0; i<data->n_im_used; i++)
+         count += data->GetRegionCount(i, region);
+   }
+   else
+   {
+      count = data->GetRegionCount(im, region);
+   }
+
+   return count * n_meas * (nl + 1);
+}
+
+/**
+ * Order the regions of a global fit from the most to the least costly, so
+ * that each wave holds regions of similar size and the largest go first
+ */
+void FLIMGlobalFitController::SetupGlobalRegions()
+{
+   std::vector<RegionTask> tasks;
+
+   for(int r=0; r<MAX_REGION; r++)
+   {
+      if (data->GetRegionIndex(-1,r) > -1)
+      {
+         RegionTask task;
+         task.im = -1;
+         task.region = r;
+         task.cost = EstimateRegionCost(-1, r);
+         tasks.push_back(task);
+      }
+   }
+
+   std::stable_sort(tasks.begin(), tasks.end(), CompareRegionCost);
+
+   global_regions.clear();
+   for(size_t i=0; i<tasks.size(); i++)
+      global_regions.push_back(tasks[i].region);
+}
+
+/**
+ * Get the regions in a wave of global mode fitting, so that regions[thread] 
+ * is fitted by thread
+ */
+void FLIMGlobalFitController::GetWaveRegions(int wave, std::vector<int>& regions)
+{
+   int begin = min(wave * n_fitters, (int) global_regions.size());
+   int end = min(begin + n_fitters, (int) global_regions.size());
+   regions.assign(global_regions.begin() + begin, global_regions.begin() + end);
+}
+
+/**
+ * Give each of the first n_busy fitters its own thread, leaving the rest of 
+ * the threads free to be shared out between the fitters' regions
+ */
+void FLIMGlobalFitController::SetupThreads(int n_busy)
+{
+   free_slots.clear();
+   for(int i=n_thread-1; i>=n_busy; i--)
+      free_slots.push_back(i);
+
+   n_inner_thread.assign(n_fitters, 1);
+   inner_slots.assign(n_fitters * max_inner_thread, 0);
+   for(int i=0; i<n_fitters; i++)
+      inner_slots[i * max_inner_thread] = i;
+}
+
+/**
+ * Choose the threads thread's fitter uses for a region of s pixels. It takes
+ * share of the free threads, where share is the region's part of the cost 
+ * of the regions still to be started, but regions too small to split are 
+ * fitted by a single thread. region_mutex must be held
+ */
+void FLIMGlobalFitController::ReserveThreads(int thread, int s, double share)
+{
+   int* slots = &inner_slots[thread * max_inner_thread];
+
+   int n = 1 + (int) (free_slots.size() * share);
+   n = min(n, max_inner_thread);
+   n = min(n, max(1, s / MIN_THREAD_PX));
+
+   // Other fits may be using the threads
+   n = 1 + ThreadPool::ReserveThreads(n - 1, job_threads);
+
+   for(int i=1; i<n; i++)
+   {
+      slots[i] = free_slots.back();
+      free_slots.pop_back();
+   }
+
+   n_inner_thread[thread] = n;
+}
+
+/**
+ * Return the extra threads used by thread's fitter once its region is 
+ * fitted. region_mutex must be held
+ */
+void FLIMGlobalFitController::ReleaseThreads(int thread)
+{
+   int* slots = &inner_slots[thread * max_inner_thread];
+
+   for(int i=n_inner_thread[thread]-1; i>=1; i--)
+      free_slots.push_back(slots[i]);
+
+   ThreadPool::ReleaseThreads(n_inner_thread[thread] - 1, job_threads);
+
+   n_inner_thread[thread] = 1;
+}
+
+/**
+ * Split the pixelwise fit into units, one for each tile of each region 
+ * of each image, in the order in which they are loaded
+ */
+void FLIMGlobalFitController::SetupPixelUnits()
+{
+   int n_tile = data->GetNumTiles();
+
+   pixel_units.clear();
+
+   for(int im=0; im<data->n_im_used; im++)
+   {
+      for(int r=0; r<MAX_REGION; r++)
+      {
+         if (data->GetRegionIndex(im,r) > -1)
+         {
+            for(int tile=0; tile<n_tile; tile++)
+            {
+               PixelUnit unit;
+               unit.im = im;
+               unit.region = r;
+               unit.tile = tile;
+               unit.size = min(y_dim, data->GetRegionCount(im,r));
+               unit.ring_pos = 0;
+               unit.region_px = 0;
+               unit.count = -1;
+               unit.next_px = 0;
+               unit.n_fitted = 0;
+
+               pixel_units.push_back(unit);
+            }
+         }
+      }
+   }
+
+   unit_gathered = 0;
+   unit_fitted = 0;
+   ring_head = 0;
+}
+
+/**
+ * List the regions to fit in imagewise mode, the most costly first. When
+ * the data is streamed the images are loaded in order, so the regions are 
+ * only reordered within each group of images which can be loaded at once
+ */
+void FLIMGlobalFitController::SetupRegionTasks()
+{
+   region_tasks.resize(data->n_regions_total);
+
+   for(int im=0; im<data->n_im_used; im++)
+   {
+      im_tasks_left[im] = 0;
+
+      for(int r=0; r<MAX_REGION; r++)
+      {
+         int idx = data->GetRegionIndex(im,r);
+         if (idx > -1)
+         {
+            region_tasks[idx].im = im;
+            region_tasks[idx].region = r;
+            region_tasks[idx].cost = EstimateRegionCost(im,r);
+            im_tasks_left[im]++;
+         }
+      }
+   }
+
+   int n_window = max(data->GetNumStreamSlots(), 1);
+   
+   std::vector<RegionTask>::iterator begin = region_tasks.begin();
+   while (begin != region_tasks.end())
+   {
+      std::vector<RegionTask>::iterator end = begin;
+      int im_end = begin->im + n_window;
+      while (end != region_tasks.end() && end->im < im_end)
+         end++;
+
+      std::stable_sort(begin, end, CompareRegionCost);
+      begin = end;
+   }
+
+   double cost_left = 0;
+   for(int t=(int)region_tasks.size()-1; t>=0; t--)
+   {
+      cost_left += region_tasks[t].cost;
+      region_tasks[t].cost_left = cost_left;
+   }
+
+   next_task = 0;
+}
+
+/**
+ * Reserve space in the ring for a unit, without wrapping it around the end
+ * of the ring. Returns false if there is not yet enough space. Call with 
+ * region_mutex locked
+ */
+bool FLIMGlobalFitController::ReservePixelUnit(PixelUnit& unit)
+{
+   int pos = ring_head;
+   if (pos % ring_size + unit.size > ring_size)
+      pos += ring_size - pos % ring_size;
+   
+   int tail = (unit_fitted < unit_gathered) ? pixel_units[unit_fitted].ring_pos : ring_head;
+   if (pos + unit.size - tail > ring_size)
+      return false;
+
+   unit.ring_pos = pos;
+   ring_head = pos + unit.size;
+   return true;
+}
+
+/**
+ * Gather the data for a unit into its space in the ring. Units are gathered
+ * in order by thread 0
+ */
+void FLIMGlobalFitController::GatherPixelUnit(int u)
+{
+   PixelUnit& unit = pixel_units[u];
+   int n_tile = data->GetNumTiles();
+
+   // Tiles of a region follow each other in the results
+   if (unit.tile > 0)
+      unit.region_px = pixel_units[u-1].region_px + pixel_units[u-1].count;
+
+   int pos = data->GetRegionPos(unit.im, unit.region) + unit.region_px;
+   int buf = unit.ring_pos % ring_size;
+
+   // The other fitters carry on fitting while we gather, so only use 
+   // threads for the transform which no fitter or other fit is using
+   int n_tr_thread = 1 + ThreadPool::ReserveThreads(n_thread - 1, job_threads);
+
+   int count = data->GetMaskedData(0, unit.im, unit.region, direct_y ? NULL : y + buf * n_meas, I + pos, r_ss + pos, acceptor + pos, 
+                                   irf_idx + buf, n_tile > 1 ? unit.tile : -1, n_tr_thread);
+
+   ThreadPool::ReleaseThreads(n_tr_thread - 1, job_threads);
+   
+   // Release the image once we have all its data
+   if (u == (int) pixel_units.size() - 1 || pixel_units[u+1].im != unit.im)
+      data->ImageDataFinished(unit.im);
+
+   region_mutex.lock();
+   unit.count = count;
+   if (u == unit_fitted)
+   {
+      while (unit_fitted < unit_gathered && pixel_units[unit_fitted].n_fitted == pixel_units[unit_fitted].count)
+         unit_fitted++;
+   }
+   region_mutex.unlock();
+}
+
+/**
+ * Wrapper function for WorkerThread
+ */
+void StartWorkerThread(void* wparams)
+{
+   WorkerParams* p = (WorkerParams*) wparams;
+
+   FLIMGlobalFitController* controller = p->controller;
+   int                      thread     = p->thread;
+
+   controller->WorkerThread(thread);
+}
+
+/**
+ * Worker thread, called several times to process regions
+ */
+void FLIMGlobalFitController::WorkerThread(int thread)
+{
+   status->AddThread();
+
+   // Pool threads are shared with other fits so set up OpenMP for this one;
+   // ProcessRegion sets the number of threads to use within each region
+   omp_set_num_threads(1);
+
+   //=============================================================================
+   // In pixelwise mode, thread 0 gathers the data for each unit (a tile of a 
+   // region of an image) in turn into the ring buffer, as long as there is 
+   // space. The pixels of the gathered units are fitted in small chunks by 
+   // whichever thread is free, so threads only wait when there is no data
+   //=============================================================================
+   if (data->global_mode == MODE_PIXELWISE)
+   {
+      int n_unit = (int) pixel_units.size();
+      
+      region_mutex.lock();
+
+      while (unit_fitted < n_unit && !(status->terminate))
+      {
+         if (thread == 0 && unit_gathered < n_unit && ReservePixelUnit(pixel_units[unit_gathered]))
+         {
+            int u = unit_gathered++;
+            region_mutex.unlock();
+
+            GatherPixelUnit(u);
+
+            region_mutex.lock();
+            active_lock.notify_all();
+            continue;
+         }
+
+         // Claim a chunk of pixels from the oldest unit with pixels left
+         int u;
+         for(u=unit_fitted; u<unit_gathered; u++)
+         {
+            PixelUnit& unit = pixel_units[u];
+            if (unit.count >= 0 && unit.next_px < unit.count)
+               break;
+         }
+
+         if (u == unit_gathered)
+         {
+            active_lock.wait(region_mutex);
+            continue;
+         }
+
+         PixelUnit& unit = pixel_units[u];
+
+         int chunk = unit.count / (4 * n_fitters);
+         chunk = max(1, min(chunk, PIXEL_CHUNK));
+
+         int px0 = unit.next_px;
+         int px1 = min(px0 + chunk, unit.count);
+         unit.next_px = px1;
+
+         region_mutex.unlock();
+
+         for(int j=px0; j<px1 && !(status->terminate); j++)
+            ProcessRegion(unit.im, unit.region, unit.region_px + j, thread, (unit.ring_pos + j) % ring_size);
+
+         region_mutex.lock();
+
+         // Once the oldest units are finished their space in the ring can be reused
+         unit.n_fitted += px1 - px0;
+         if (u == unit_fitted)
+         {
+            while (unit_fitted < unit_gathered && pixel_units[unit_fitted].n_fitted == pixel_units[unit_fitted].count)
+               unit_fitted++;
+            active_lock.notify_all();
+         }
+      }
+
+      region_mutex.unlock();
+
+      if (status->terminate)
+         goto terminated;
+   }
+
+   //=============================================================================
+   // In imagewise mode, each region from each image is processed seperately. 
+   // Each thread takes the next region from the task list in turn, so the
+   // most costly regions are fitted first, along with a share of any idle
+   // threads to use within the region
+   //=============================================================================
+   else if (data->global_mode == MODE_IMAGEWISE)
+   {
+      int n_task = (int) region_tasks.size();
+
+      while (!(status->terminate))
+      {
+         int t = next_task++;
+         if (t >= n_task)
+            break;
+
+         RegionTask& task = region_tasks[t];
+
+         region_mutex.lock();
+         ReserveThreads(thread, data->GetRegionCount(task.im, task.region), task.cost / task.cost_left);
+         region_mutex.unlock();
+
+         int im = task.im;
+         ProcessRegion(im, task.region, 0, thread);
+
+         region_mutex.lock();
+         ReleaseThreads(thread);
+         region_mutex.unlock();
+
+         // Release the image once all its regions have been fitted
+         if (--im_tasks_left[im] == 0)
+            data->ImageDataFinished(im);
+      }
+
+      // There's nothing left for this fitter so others can use its thread
+      region_mutex.lock();
+      free_slots.push_back(thread);
+      ThreadPool::ReleaseThreads(1, job_threads);
+      region_mutex.unlock();
+   }
+
+   //=============================================================================
+   // In global mode each region is processed seperately across the images
+   // so we processes all region 1's from every image together etc
+   // Each thread processes a different region. The regions are processed in
+   // waves of n_fitters: thread 0 gathers the data for every region in the
+   // wave in a single streamed pass over the images and then starts loading 
+   // the images for the next wave while the regions are fitted
+   //=============================================================================
+   else
+   {
+      std::vector<int> regions;
+      int n_wave = (data->n_regions_total + n_fitters - 1) / n_fitters;
+
+      for(int wave=0; wave<n_wave; wave++)
+      {
+         region_mutex.lock();
+
+         if (thread > 0)
+         {
+            while (cur_wave < wave && !(status->terminate))
+               active_lock.wait(region_mutex);
+         }
+         else
+         {
+            // Wait for every thread to finish fitting the last wave before 
+            // we overwrite their data
+            while (wave_threads_done < n_fitters && cur_wave >= 0 && !(status->terminate))
+               active_lock.wait(region_mutex);
+         }
+         
+         region_mutex.unlock();
+
+         if (status->terminate)
+            break;
+         
+         GetWaveRegions(wave, regions);
+
+         if (thread == 0)
+         {
+            int n_region = (int) regions.size();
+            std::vector<float*> region_y(n_region);
+            std::vector<int*> region_irf_idx(n_region);
+            std::vector<float*> region_decay(n_region);
+
+            for(int k=0; k<n_region; k++)
+            {
+               region_y[k]       = y           + k * y_dim * n_meas;
+               region_irf_idx[k] = irf_idx     + k * y_dim;
+               region_decay[k]   = local_decay + k * n_meas;
+            }
+
+            // The other fitters are waiting so we can use their threads, 
+            // as far as other fits allow
+            ThreadPool::SetJobThreads(1, job_threads);
+            int n_gather = 1 + ThreadPool::ReserveThreads(n_thread - 1, job_threads);
+
+            data->GetGlobalRegionsData(0, n_region, &regions[0], &region_y[0], I, r_ss, acceptor, 
+                                       &region_irf_idx[0], &region_decay[0], &wave_px[0], n_gather);
+
+            data->StopStreaming();
+            if (wave + 1 < n_wave)
+            {
+               std::vector<int> next_regions;
+               GetWaveRegions(wave + 1, next_regions);
+               data->StartStreaming(true, next_regions);
+            }
+
+            region_mutex.lock();
+
+            // Share the threads of fitters without a region in this wave
+            // between the regions, according to their size
+            ThreadPool::SetJobThreads(n_region, job_threads);
+            SetupThreads(n_region);
+
+            double px_left = 0;
+            for(int k=0; k<n_region; k++)
+               px_left += wave_px[k];
+
+            for(int k=0; k<n_region; k++)
+            {
+               if (wave_px[k] > 0)
+                  ReserveThreads(k, wave_px[k], wave_px[k] / px_left);
+               px_left -= wave_px[k];
+            }
+
+            cur_wave = wave;
+            wave_threads_done = 0;
+            active_lock.notify_all();
+            region_mutex.unlock();
+         }
+
+         if (thread < (int) regions.size())
+            ProcessRegion(-1, regions[thread], 0, thread);
+
+         region_mutex.lock();
+         wave_threads_done++;
+         active_lock.notify_all();
+         region_mutex.unlock();
+           
+         if (status->terminate)
+            break;
+      }
+   }
+
+terminated:
+
+   status->RemoveThread();
+
+   // If we're the last thread running give back the fit's threads and 
+   // cleanup temporary variables, otherwise let RunWorkers know we're done
+   worker_mutex.lock();
+   bool last = (--n_worker_running == 0);
+   bool cleanup = last && runAsync;
+   if (last)
+   {
+      ThreadPool::FinishJob(job_threads);
+
+      // Images which couldn't be read weren't fitted
+      if (data->GetLoadError() != SUCCESS)
+         error = data->GetLoadError();
+   }
+   worker_cond.notify_all();
+   worker_mutex.unlock();
+
+   if (cleanup)
+   {
+      data->StopStreaming();
+      CleanupTempVars();
+   }
+}
+
+
+void FLIMGlobalFitController::SetData(FLIMData* data)
+{
+   this->data = data;
+
+   n_t = data->n_t;
+   t = data->GetT();
+
+   // The TVB profile is given at the resolution of the source data
+   tvb_profile = src_tvb_profile;
+   if (tvb_profile != NULL && data->time_bin > 1)
+   {
+      rebin_tvb_profile.resize(data->n_meas);
+      data->RebinProfile(src_tvb_profile, &rebin_tvb_profile[0]);
+      tvb_profile = &rebin_tvb_profile[0];
+   }
+}
+
+
+void FLIMGlobalFitController::SetPolarisationMode(int mode)
+{
+   if (mode == MODE_STANDARD)
+      this->polarisation_resolved = false;
+   else
+      this->polarisation_resolved = true;
+}
+
+/**
+ * Determine which data should be used when we're calculating the average lifetime for an initial guess. 
+ * Since we won't take the IRF into account we need to only use data after the gate is mostly closed.
+ * 
+ * \param idx The pixel index, used if we have a spatially varying IRF
+*/
+int FLIMGlobalFitController::DetermineMAStartPosition(int idx)
+{
+   double c;
+   int j_last = 0;
+   int start = 0;
+   
+
+   // Get reference to timepoints
+   double* t = data->GetT();
+   
+   // Get IRF for the pixel position idx
+   double *irf = this->irf_buf + idx * n_irf * n_chan;
+
+   //===================================================
+   // If we have a scatter IRF use data after cumulative sum of IRF is
+   // 95% of total sum (so we ignore any potential tail etc)
+   //===================================================
+   if (!ref_reconvolution)
+   {      
+      // Determine 95% of IRF
+      double irf_95 = 0;
+      for(int i=0; i<n_irf; i++)
+         irf_95 += irf[i];
+      irf_95 *= 0.95;
+   
+      // Cycle through IRF to find time at which cumulative IRF is 95% of sum.
+      // Once we get there, find the time gate in the data immediately after this time
+      c = 0;
+      for(int i=0; i<n_irf; i++)
+      {
+         c += irf[i];
+         if (c >= irf_95)
+         {
+            for (int j=j_last; j<data->n_t; j++)
+               if (t[j] > t_irf[i])
+               {
+                  start = j;
+                  j_last = j;
+                  break;
+               }
+            break;
+         }   
+      }
+   }
+
+   //===================================================
+   // If we have reference IRF, use data after peak of reference which should roughly
+   // correspond to end of gate
+   //===================================================
+   else
+   {
+      // Cycle through IRF, if IRF is larger then previously seen find the find the 
+      // time gate in the data immediately after this time. Repeat until end of IRF.
+      c = 0;
+      for(int i=0; i<n_irf; i++)
+      {
+         if (irf[i] > c)
+         {
+            c = irf[i];
+            for (int j=j_last; j<data->n_t; j++)
+               if (t[j] > t_irf[i])
+               {
+                  start = j;
+                  j_last = j;
+                  break;
+               }
+         }
+      }
+   }
+
+
+   return start;
+}
+
+/**
+ * Estimate average lifetime of a decay as an intial guess
+ */ 
+double FLIMGlobalFitController::EstimateAverageLifetime(float decay[], int p)
+{
+   double* t   = data->GetT();
+   double  tau = 0;
+   int     start;
+   
+   //if (image_irf)
+   //   start = DetermineMAStartPosition(p);
+   //else
+      start = ma_start;
+     
+   //===================================================
+   // For TCSPC data, calculate the mean arrival time and apply a correction for
+   // the data censoring (i.e. finite measurement window)
+   //===================================================
+
+   if (data->data_type == DATA_TYPE_TCSPC)
+   {
+      double t_mean = 0;
+      double  n  = 0;
+      double c;
+
+      for(int i=start; i<n_t; i++)
+      {
+         c = decay[i]-adjust_buf[i];
+         t_mean += c * (t[i] - t[start]);
+         n   += c;
+      }
+   
+      // If polarisation resolevd add perp decay using I = para + 2*g*perp
+      if (polarisation_resolved)
+      {
+         for(int i=start; i<n_t; i++)
+         {
+            t_mean += 2 * g_factor * decay[i+n_t] * (t[i] - t[start]);
+            n   += 2 * g_factor * decay[i+n_t];
+         }
+      }
+
+      t_mean = t_mean / n;
+
+      // Apply correction for measurement window
+      double T = t[n_t-1]-t[start];
+      
+      // Older iterative correction; tends to same value more slowly
+      //tau = t_mean;
+      //for(int i=0; i<10; i++)  
+      //   tau = t_mean + T / (exp(T/tau)-1);
+
+      t_mean /= T;
+      tau = t_mean;
+
+      // Newton-Raphson update
+      for(int i=0; i<3; i++)  
+      {
+         double e = exp(1/tau);
+         double iem1 = 1/(e-1);
+         tau = tau - ( - tau + t_mean + iem1 ) / ( e * iem1 * iem1 / (tau*tau) - 1 );
+      }
+      tau *= T;
+   }
+
+   //===================================================
+   // For widefield data, apply linearised model 
+   //===================================================
+
+   else
+   {
+      double sum_t  = 0;
+      double sum_t2 = 0;
+      double sum_tlnI = 0;
+      double sum_lnI = 0;
+      double dt;
+      int    N;
+
+      double log_di;
+      double* t_int = data->t_int;
+
+      N = n_t-start;
+
+      for(int i=start; i<n_t; i++)
+      {
+         dt = t[i]-t[start];
+
+         sum_t += dt;
+         sum_t2 += dt * dt;
+
+         if ((decay[i]-adjust_buf[i]) > 0)
+            log_di = log((decay[i]-adjust_buf[i])/t_int[i]);
+         else
+            log_di = 0;
+
+         sum_tlnI += dt * log_di;
+         sum_lnI  += log_di;
+
+      }
+
+      tau  = - (N * sum_t2   - sum_t * sum_t);
+      tau /=   (N * sum_tlnI - sum_t * sum_lnI);
+
+   }
+
+   return tau;
+
+}
+ 
+/** 
+ * Calculate g factor for polarisation resolved data
+ *
+ * g factor gives relative sensitivity of parallel and perpendicular channels, 
+ * and so can be determined from the ratio of the IRF's for the two channels 
+*/
+double FLIMGlobalFitController::CalculateGFactor()
+{
+   if (polarisation_resolved)
+   {
+      double perp = 0;
+      double para = 0;
+      for(int i=0; i<n_irf; i++)
+      {
+         para += irf[i];
+         perp += irf[i+n_irf];
+      }
+
+      g_factor = para / perp;
+   }
+   else
+   {
+      g_factor = 1;
+   }
+
+   return g_factor;
+}
+
+
+void FLIMGlobalFitController::Init()
+{
+
+   next_task = 0;
+   unit_gathered = 0;
+   unit_fitted = 0;
+   ring_size = 0;
+   ring_head = 0;
+   cur_wave = -1;
+   wave_threads_done = 0;
+
+   getting_fit    = false;
+   use_kappa      = true;
+   
+   // Validate input
+   //---------------------------------------
+   if (polarisation_resolved)
+   {
+      if (fit_beta == FIT_LOCALLY)
+         fit_beta = FIT_GLOBALLY;
+
+      if (n_fret > 0)
+         n_fret = 0;
+   }
+
+   if (n_thread < 1)
+      n_thread = 1;
+
+
+   // Set up FRET parameters
+   //---------------------------------------
+   fit_fret = (n_fret > 0) & (fit_beta != FIT_LOCALLY);
+   if (!fit_fret)
+   {
+      n_fret = 0;
+      n_fret_fix = 0;
+      inc_donor = true;
+   }
+   else
+      n_fret_fix = min(n_fret_fix,n_fret);
+ 
+   n_fret_v = n_fret - n_fret_fix;
+      
+   tau_start = inc_donor ? 0 : 1;
+
+   beta_global = (fit_beta != FIT_LOCALLY);
+
+   photons_per_count = data->GetPhotonsPerCount();
+
+   // Set up polarisation resolved measurements
+   //---------------------------------------
+   if (polarisation_resolved)
+   {
+      n_chan = 2;
+      n_r = n_theta + inc_rinf;
+      n_pol_group = n_r + 1;
+
+      chan_fact = new double[ n_chan * n_pol_group ]; //free ok
+      int i;
+
+      double f = +0.00;
+
+      chan_fact[0] = 1.0/3.0- f*1.0/3.0;
+      chan_fact[1] = (1.0/3.0) + f*1.0/3.0;
+
+      for(i=1; i<n_pol_group ; i++)
+      {
+         chan_fact[i*2  ] =   2.0/3.0 - f*2.0/3.0;
+         chan_fact[i*2+1] =  -(1.0/3.0) + f*2.0/3.0;
+      }
+
+     
+   }
+   else
+   {
+      n_chan = 1;
+      n_pol_group = 1;
+      n_r = 0;
+
+      chan_fact = new double[1]; //free ok
+      chan_fact[0] = 1;
+   }
+
+   n_theta_v = n_theta - n_theta_fix;
+
+   n_meas = n_t * n_chan;
+
+   decay_group_buf = new int[n_exp];
+
+   if (beta_global)
+   {
+
+      // Check to make sure that decay groups increase
+      // contiguously from zero
+      int cur_group = 0;
+      if (decay_group != NULL)
+      {
+         for(int i=0; i<n_exp; i++)
+         {
+            if (decay_group[i] == (cur_group + 1))
+            {
+               cur_group++;
+            }
+            else if (decay_group[i] != cur_group)
+            {
+               decay_group = NULL;
+               break;
+            }
+         }
+      }
+   }
+   else
+   {
+      decay_group = NULL;
+      n_decay_group = 1;
+   }
+
+   if (decay_group == NULL)
+      for(int i=0; i<n_exp; i++)
+         decay_group_buf[i] = 0;
+   else
+      for(int i=0; i<n_exp; i++)
+         decay_group_buf[i] = decay_group[i];
+
+
+
+
+
+   // Copy IRF, padding to ensure we have an even number of points so we can 
+   // use SSE primatives in convolution
+   //------------------------------
+   int n_irf_rep;
+   
+   if (image_irf) 
+      n_irf_rep =  data->n_px;
+   else
+      n_irf_rep = 1;
+
+   int n_irf_buf = max(1 + n_thread, n_irf_rep);
+   
+   int a_n_irf = (int) ( ceil(n_irf / 2.0) * 2 );
+   int irf_size = a_n_irf * n_chan * n_irf_buf;
+   #ifdef _WIN32
+      irf_buf   = (double*) _aligned_malloc(irf_size*sizeof(double), 16);
+      t_irf_buf = (double*) _aligned_malloc(a_n_irf*sizeof(double), 16);
+   #else
+      irf_buf  = new double[irf_size]; 
+      t_irf_buf  = new double[a_n_irf]; 
+   #endif
+      
+
+   double dt = t_irf[1]-t_irf[0];
+
+    for(int j=0; j<n_irf_rep; j++)
+   {
+      int i;
+      for(i=0; i<n_irf; i++)
+      {
+         t_irf_buf[i] = t_irf[i];
+         for(int k=0; k<n_chan; k++)
+             irf_buf[j*a_n_irf*n_chan+k*a_n_irf+i] = irf[j*n_irf*n_chan+k*n_irf+i];
+      }
+      for(; i<a_n_irf; i++)
+      {
+         t_irf_buf[i] = t_irf_buf[i-1] + dt;
+         for(int k=0; k<n_chan; k++)
+            irf_buf[j*a_n_irf*n_chan+k*a_n_irf+i] = irf_buf[j*a_n_irf*n_chan+k*a_n_irf+i-1];
+      }
+   }
+
+   n_irf = a_n_irf;
+
+   
+   if (data->global_mode == MODE_GLOBAL || (data->global_mode == MODE_IMAGEWISE && data->n_px > 1))
+      algorithm = ALG_LM;
+
+   
+   if (data->global_mode == MODE_PIXELWISE)
+   {
+      status->SetNumRegion(data->n_masked_px);
+      n_fitters = min(data->n_px,n_thread);
+   }
+   else
+   {
+      status->SetNumRegion(data->n_regions_total);
+      n_fitters = min(data->n_regions_total,n_thread);
+   }
+
+   // Don't start more fitters than our share of the threads shared by all fits
+   n_fitters = min(n_fitters, ThreadPool::GetFairShare());
+
+   
+   if (data->n_regions_total == 0)
+   {
+      error = ERR_FOUND_NO_REGIONS;
+      return;
+   }
+
+   // Only create as many fitters as there are regions if we have fewer 
+   // regions than threads. The spare threads, and those of fitters which 
+   // are idle, are shared between the regions being fitted (see ReserveThreads)
+   //---------------------------------------
+
+   if (data->global_mode == MODE_PIXELWISE)
+      max_inner_thread = 1;
+   else
+      max_inner_thread = max(n_thread - n_fitters + 1, min(n_thread, MIN_INNER_THREAD));
+
+   // Supplied t_rep in seconds, convert to ps
+   this->t_rep = t_rep * 1e12;
+
+   n_fret_group = n_fret + inc_donor;        // Number of decay 'groups', i.e. FRETing species + no FRET
+
+   n_v = n_exp - n_fix;                      // Number of unfixed exponentials
+   
+   n_exp_phi = (beta_global ? n_decay_group : n_exp);
+   
+   n_beta = (fit_beta == FIT_GLOBALLY) ? n_exp - n_decay_group : 0;
+   
+   nl  = n_v + n_fret_v + n_beta + n_theta_v;                                // (varp) Number of non-linear parameters to fit
+   p   = (n_v + n_beta)*n_fret_group*n_pol_group + n_exp_phi * n_fret_v + n_theta_v;    // (varp) Number of elements in INC matrix 
+   l   = n_exp_phi * n_fret_group * n_pol_group;          // (varp) Number of linear parameters
+
+   if (data->global_mode == MODE_GLOBAL)
+      s = data->n_masked_px;                              // (varp) Number of pixels (right hand sides)
+   else if (data->global_mode == MODE_IMAGEWISE)
+      s = data->n_px;
+   else
+      s = 1;
+
+   y_dim = max(s,data->n_px);
+
+   // In pixelwise mode y holds the decays from a ring of tiles (or whole 
+   // regions if we're not tiling) which are shared by all the threads. The 
+   // ring holds two tiles so that one can be gathered while one is fitted
+   if (data->global_mode == MODE_PIXELWISE)
+   {
+      y_dim = data->GetTilePixels();
+      ring_size = 2 * y_dim;
+   }
+
+   // In pixelwise mode the fitters may be able to read decays straight from 
+   // the data, in which case y only holds a decay per thread when one has to
+   // be transformed
+   direct_y = data->UseDirectDecays();
+
+   max_dim = max(n_irf,n_t);
+   max_dim = (int) (ceil(max_dim/4.0) * 4);
+
+
+   exp_dim = max_dim * n_chan;
+
+   if (ref_reconvolution == FIT_GLOBALLY) // fitting reference lifetime
+   {
+      nl++;
+      p += l;
+   }
+
+   // Check whether t0 has been specified
+   if (fit_t0 == FIT)
+   {
+      nl++;
+      p += l;
+   }
+
+   if (fit_offset == FIT_GLOBALLY)
+   {
+      nl++;
+      p++;
+   }
+
+   if (fit_scatter == FIT_GLOBALLY)
+   {
+      nl++;
+      p++;
+   }
+
+   if (fit_tvb == FIT_GLOBALLY)
+   {
+      nl++;
+      p++;
+   }
+
+   if (fit_offset == FIT_LOCALLY)
+   {
+      l++;
+   }
+
+   if (fit_scatter == FIT_LOCALLY)
+   {
+      l++;
+   }
+
+   if (fit_tvb == FIT_LOCALLY)
+   {
+      l++;
+   }
+
+   // If using MLE, need an extra non-linear scaling factor
+   if (algorithm == ALG_ML)
+   {
+      nl += l;
+   }
+
+   if (data->global_mode == MODE_GLOBAL)
+      n = data->GetResampleNumMeas(0);
+   else
+      n = n_meas;
+
+   ndim       = max( n, 2*nl+3 );
+   nmax       = n + 16; // pad to prevent false sharing   
+
+   calculate_mean_lifetimes = !beta_global && n_exp > 1;
+
+   int n_j = fit_fret ? n_fret_group : n_exp_phi;
+
+   if (!polarisation_resolved && n_j == 1)
+      lmax = l;
+   else
+      lmax = l+1; // for I, which we will compute afterwards
+
+   if (polarisation_resolved && n_theta == 2)
+      lmax += 2; // for cluster size, f_cluster
+
+   exp_buf_size = n_exp * n_fret_group * n_pol_group * exp_dim * N_EXP_BUF_ROWS;
+
+   int alf_size = (data->global_mode == MODE_PIXELWISE) ? data->n_masked_px : data->n_regions_total;
+
+   try
+   {
+      lin_params   = new float[ data->n_masked_px * lmax ]; //ok
+      chi2         = new float[ data->n_masked_px ]; //ok
+      I            = new float[ data->n_masked_px ];
+
+      if (polarisation_resolved)
+         r_ss      = new float[ data->n_masked_px ];
+
+      if (data->has_acceptor)
+         acceptor  = new float[ data->n_masked_px ];
+
+      ierr         = new int[ data->n_regions_total ];
+      success      = new float[ data->n_regions_total ];
+      alf          = new float[ alf_size * nl ]; //ok
+
+      if (calculate_errors)
+      {
+         alf_err_lower = new float[ alf_size * nl ];
+         alf_err_upper = new float[ alf_size * nl ];
+      }
+      
+      if (calculate_mean_lifetimes)
+      {
+         w_mean_tau   = new float[ data->n_masked_px ];  
+         mean_tau     = new float[ data->n_masked_px ];  
+      }
+      
+
+      alf_local    = new double[ n_fitters * nl * 3 ]; //free ok
+      if (data->global_mode == MODE_PIXELWISE)
+      {
+         y         = new float[ (direct_y ? n_fitters : ring_size) * n_meas ]; //free ok 
+         irf_idx   = new int[ ring_size ];
+      }
+      else
+      {
+         y         = new float[ n_fitters * y_dim * n_meas ]; //free ok 
+         irf_idx   = new int[ n_fitters * y_dim ];
+      }
+      wave_px.assign(n_fitters, 0);
+
+	  binned_decay = new float[n_fitters * n_meas]; //ok
+	  local_decay = new float[n_fitters * n_meas]; //ok
+      lin_local    = new float[ n_fitters * lmax ]; //ok
+      w            = new float[ n_fitters * n_meas ]; //free ok
+
+      cur_alf      = new double[ n_thread * nl ]; //ok
+      cur_irf_idx  = new int[ n_thread ];
+
+      if (data->global_mode == MODE_IMAGEWISE)
+         im_tasks_left = new std::atomic<int>[ data->n_im_used ]; //ok
+
+      #ifdef _WIN32
+         exp_buf   = (double*) _aligned_malloc( n_thread * exp_buf_size * sizeof(double), 16 ); //ok
+       #else
+         exp_buf   = new double[n_thread * exp_buf_size];
+       #endif
+      
+      tau_buf      = new double[ n_thread * (n_fret+1) * n_exp ]; //free ok 
+      beta_buf     = new double[ n_thread * n_exp ]; //free ok
+      theta_buf    = new double[ n_thread * n_theta ]; //free ok 
+      adjust_buf   = new float[ n_meas ]; // free ok 
+
+    
+      irf_max      = new int[n_meas]; //free ok
+
+      init = true;
+   }
+   catch(std::exception e)
+   {
+      error =  ERR_OUT_OF_MEMORY;
+      CleanupTempVars();
+      CleanupResults();
+      return;
+   }
+
+   SetNaN( cur_alf, n_thread * nl );
+   
+   for(int i=0; i<n_thread; i++)
+      cur_irf_idx[i] = -1;
+
+   SetNaN(alf, alf_size * nl );
+   SetNaN(chi2, data->n_masked_px );
+   SetNaN(I, data->n_masked_px );
+   SetNaN(r_ss, data->n_masked_px );
+   SetNaN(lin_params, data->n_masked_px * lmax);
+
+   for(int i=0; i<data->n_regions_total; i++)
+   {
+      success[i] = 0;
+      ierr[i] = 0;
+   }
+
+
+   if (n_irf > 2)
+      t_g = t_irf[1] - t_irf[0];
+   else
+      t_g = 1;
+
+
+   // Check to see if gates are equally spaced
+   //---------------------------------------------
+   eq_spaced_data = true;
+   double dt0 = t[1]-t[0];
+   for(int i=2; i<n_t; i++)
+   {
+      double dt = t[i] - t[i-1];
+      if (abs(dt - dt0) > 1)
+      {
+         eq_spaced_data = false;
+         break;
+      }
+         
+   }
+
+   CalculateIRFMax(n_t,t);
+   ma_start = DetermineMAStartPosition(0);
+
+   // Create fitting objects
+   projectors.reserve(n_fitters);
+
+   int variable_phi = (image_irf || t0_image != NULL || data->image_t0_shift != NULL);
+
+   for(int i=0; i<n_fitters; i++)
+   {
+      if (algorithm == ALG_ML)
+         projectors.push_back( std::make_shared<MaximumLikelihoodFitter>(this, l, nl, n, ndim, p, t, &(status->terminate)) );
+      else
+         projectors.push_back( std::make_shared<VariableProjector>(this, s, l, nl, n, ndim, p, t, variable_phi, weighting, max_inner_thread, &(status->terminate)) );
+   }
+
+   for(int i=0; i<n_fitters; i++)
+   {
+      if (projectors[i]->err != 0)
+         error = projectors[i]->err;
+   }
+
+
+   // Select correct convolution function for data type
+   //-------------------------------------------------
+   Convolve = conv_irf;
+   ConvolveDerivative = conv_irf_deriv;
+
+   // Setup adjust buffer which will be subtracted from the data
+   SetupAdjust(0, adjust_buf, (fit_scatter == FIX) ? (float) scatter_guess : 0, 
+                              (fit_offset == FIX)  ? (float) offset_guess  : 0, 
+                              (fit_tvb == FIX)     ? (float) tvb_guess     : 0);
+
+   // Set alf indices
+   //-----------------------------
+   int idx = n_v;
+
+   if (fit_beta == FIT_GLOBALLY)
+   {
+     alf_beta_idx = idx;
+     idx += n_beta;
+   }
+
+   if (fit_fret == FIT)
+   {
+     alf_E_idx = idx;
+     idx += n_fret_v;
+   }
+
+   alf_theta_idx = idx; 
+   idx += n_theta_v;
+
+   if (ref_reconvolution == FIT_GLOBALLY)
+     alf_ref_idx = idx++;
+
+   if (fit_t0 == FIT)
+      alf_t0_idx = idx++;
+
+   if (fit_offset == FIT_GLOBALLY)
+      alf_offset_idx = idx++;
+
+  if (fit_scatter == FIT_GLOBALLY)
+      alf_scatter_idx = idx++;
+
+  if (fit_tvb == FIT_GLOBALLY)
+      alf_tvb_idx = idx++;
+
+
+   SetOutputParamNames();
+
+
+   // standard normal distribution object:
+   boost::math::normal norm;
+   conf_factor = quantile(complement(norm, 0.5*conf_interval));
+
+
+}
+
+
+void FLIMGlobalFitController::SetOutputParamNames()
+{
+   char buf[1024];
+
+   // Parameters associated with non-linear parameters (or fixed)
+
+   for(int i=0; i<n_exp; i++)
+   {
+      sprintf(buf,"tau_%i",i+1);
+      param_names.push_back(buf);
+   }
+
+   if (fit_beta != FIT_LOCALLY)
+      for(int i=0; i<n_exp; i++)
+      {
+         sprintf(buf,"beta_%i",i+1);
+         param_names.push_back(buf);
+      }
+
+   for(int i=0; i<n_fret; i++)
+   {
+      sprintf(buf,"E_%i",i+1);
+      param_names.push_back(buf);
+   }
+
+   for(int i=0; i<n_theta; i++)
+   {
+      sprintf(buf,"theta_%i",i+1);
+      param_names.push_back(buf);
+   }
+
+   if (ref_reconvolution == FIT_GLOBALLY)
+      param_names.push_back("tau_ref");
+
+   if (fit_t0 == FIT)
+      param_names.push_back("t0");
+
+   if (fit_offset == FIT_GLOBALLY)
+      param_names.push_back("offset");
+
+   if (fit_scatter == FIT_GLOBALLY)
+      param_names.push_back("scatter");
+
+   if (fit_tvb == FIT_GLOBALLY)
+      param_names.push_back("tvb");
+
+
+   n_nl_output_params = (int) param_names.size();
+
+   if (fit_offset == FIT_LOCALLY)
+      param_names.push_back("offset");
+
+   if (fit_scatter == FIT_LOCALLY)
+      param_names.push_back("scatter");
+
+   if (fit_tvb == FIT_LOCALLY)
+      param_names.push_back("tvb");
+
+   // Now that parameters that are derived from the linear parameters
+
+   if (fit_beta == FIT_LOCALLY && n_exp > 1)
+      for(int i=0; i<n_exp; i++)
+      {
+         sprintf(buf,"beta_%i",i+1);
+         param_names.push_back(buf);
+      }
+
+   if (n_decay_group > 1)
+      for(int i=0; i<n_decay_group; i++)
+      {
+         sprintf(buf,"gamma_%i",i+1);
+         param_names.push_back(buf);
+      }
+
+   if (fit_fret == FIT && inc_donor)
+   {
+      sprintf(buf,"gamma_0");
+      param_names.push_back(buf);
+   }
+
+   if (n_fret_group > 1)
+      for(int i=0; i<n_fret; i++)
+      {
+         sprintf(buf,"gamma_%i",i+1);
+         param_names.push_back(buf);
+      }
+
+   if (polarisation_resolved)
+      param_names.push_back("r_0");
+
+   for(int i=0; i<n_theta; i++)
+   {
+      sprintf(buf,"r_%i",i+1);
+      param_names.push_back(buf);
+   }
+
+   param_names.push_back("I0");
+   
+   if (polarisation_resolved && n_theta == 2)
+   {
+      param_names.push_back("N_cluster");
+      param_names.push_back("f_cluster");
+   }
+
+   // Parameters we manually calculate at the end
+   
+   param_names.push_back("I");
+
+   if ( acceptor != NULL )
+      param_names.push_back("acceptor");
+
+   if (polarisation_resolved)
+      param_names.push_back("r_ss");
+
+
+   if (calculate_mean_lifetimes)
+   {
+      param_names.push_back("mean_tau");
+      param_names.push_back("w_mean_tau");
+   }
+
+   param_names.push_back("chi2");
+
+   n_output_params = (int) param_names.size();
+
+   param_names_ptr = new const char*[n_output_params];
+
+   for(int i=0; i<n_output_params; i++)
+      param_names_ptr[i] = param_names[i].c_str();
+
+}
+
+
+FLIMGlobalFitController::~FLIMGlobalFitController()
+{
+   status->Terminate();
+
+   while (status->IsRunning()) {}
+
+   CleanupResults();
+   CleanupTempVars();
+
+   delete status;
+   delete[] params;
+
+}
+
+/** 
+ * Calculate IRF values to include in convolution for each time point
+ *
+ * Accounts for the step function in the model - we don't want to convolve before the decay starts
+*/
+void FLIMGlobalFitController::CalculateIRFMax(int n_t, double t[])
+{
+   for(int j=0; j<n_chan; j++)
+   {
+      for(int i=0; i<n_t; i++)
+      {
+         irf_max[j*n_t+i] = 0;
+         int k=0;
+         while(k < n_irf && (t[i] - t_irf[k]) >= -1.0)
+         {
+            irf_max[j*n_t+i] = k + j*n_irf;
+            k++;
+         }
+      }
+   }
+
+}
+
+
+int FLIMGlobalFitController::GetErrorCode()
+{
+   return error;
+}
+
+void FLIMGlobalFitController::SetupAdjust(int thread, float adjust[], float scatter_adj, float offset_adj, float tvb_adj)
+{
+
+   double scale_fact[2];
+   scale_fact[0] = 1;
+   scale_fact[1] = 0;
+
+   for(int i=0; i<n_meas; i++)
+      adjust[i] = 0;
+
+   add_irf(thread, 0, 0, adjust, n_r, scale_fact);
+
+   for(int i=0; i<n_meas; i++)
+      adjust[i] = adjust[i] * scatter_adj + offset_adj;
+
+   if (tvb_profile != NULL)
+   {
+      for(int i=0; i<n_meas; i++)
+         adjust[i] += (float) (tvb_profile[i] * tvb_adj);
+   }
+
+   for(int i=0; i<n_meas; i++)
+      adjust[i] = adjust[i] *= photons_per_count;
+}
+
+
+
+void FLIMGlobalFitController::CleanupTempVars()
+{
+
+   tthread::lock_guard<tthread::recursive_mutex> guard(cleanup_mutex);
+   
+   ClearVariable(y);
+
+   for(auto p : projectors)
+      p->ReleaseResidualMemory();
+
+   //_ASSERTE(_CrtCheckMemory());
+}
+
+void FLIMGlobalFitController::CleanupResults()
+{
+
+   tthread::lock_guard<tthread::recursive_mutex> guard(cleanup_mutex);
+
+   init = false;
+      
+   ClearVariable(lin_local);
+   ClearVariable(alf_local);
+   ClearVariable(tau_buf);
+   ClearVariable(beta_buf);
+   ClearVariable(theta_buf);
+   ClearVariable(chan_fact);
+   ClearVariable(cur_alf);
+   ClearVariable(cur_irf_idx);
+
+   ClearVariable(I);
+   ClearVariable(chi2);
+   ClearVariable(alf);
+   ClearVariable(lin_params);
+   ClearVariable(ierr);
+   ClearVariable(success);
+   ClearVariable(w_mean_tau);
+   ClearVariable(mean_tau);
+   ClearVariable(r_ss);
+   ClearVariable(acceptor);
+
+   #ifdef _WIN32
+   
+      if (exp_buf != NULL)
+      {
+         _aligned_free(exp_buf);
+         exp_buf = NULL;
+      }
+      if (irf_buf != NULL)
+      {
+         _aligned_free(irf_buf);
+         irf_buf = NULL;
+      }
+      if (t_irf_buf != NULL)
+      {
+         _aligned_free(t_irf_buf);
+         t_irf_buf = NULL;
+      }
+   
+   #else
+   
+      ClearVariable(exp_buf);
+      ClearVariable(irf_buf);
+      ClearVariable(t_irf_buf);
+   
+   #endif
+
+
+      ClearVariable(irf_max);
+      ClearVariable(adjust_buf);
+      ClearVariable(local_decay);
+	  ClearVariable(binned_decay);
+	  ClearVariable(decay_group_buf);
+
+      ClearVariable(irf_idx);
+
+      ClearVariable(y);
+      ClearVariable(w);
+      
+      ClearVariable(param_names_ptr);
+
+      ClearVariable(im_tasks_left);
+
+      if (result_map_filename != NULL)
+      {
+         remove(result_map_filename);
+         free(result_map_filename);
+         result_map_filename = NULL;
+      }
+
+      if (data != NULL)
+      {
+         delete data;
+         data = NULL;
+      }
+
+     //_ASSERTE(_CrtCheckMemory());
+}
+
 #endif
\ No newline at end of file
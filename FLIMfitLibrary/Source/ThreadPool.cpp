@@ -0,0 +1,358 @@
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+
+
+#include "ThreadPool.h"
+
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+/**
+ * The pool's state is never destroyed, as its threads are still waiting
+ * on it when the process exits
+ */
+ThreadPool::State& ThreadPool::GetState()
+{
+   static State* state = CreateState();
+   return *state;
+}
+
+/**
+ * Run fcn(param) on a thread from the pool, starting a new thread if all
+ * the threads are busy. Returns without waiting for the task to finish.
+ * slot is the index of the task within its fit (e.g. the fitter thread), 
+ * which picks the NUMA node it is pinned to; tasks with no slot aren't pinned
+ */
+void ThreadPool::Run(void (*fcn)(void*), void* param, int slot)
+{
+   State& state = GetState();
+
+   Task task;
+   task.fcn = fcn;
+   task.param = param;
+   task.slot = slot;
+
+   state.mutex.lock();
+
+   state.tasks.push_back(task);
+   bool start_thread = ((int) state.tasks.size() > state.n_idle);
+
+   state.mutex.unlock();
+
+   if (start_thread)
+   {
+      tthread::thread* thread = new tthread::thread(WorkerLoop, NULL); // ok
+      thread->detach();
+      delete thread;
+   }
+   else
+   {
+      state.task_cond.notify_one();
+   }
+}
+
+/**
+ * Run tasks as they are submitted, pinning the thread to the node for 
+ * each task's slot when pinning is on
+ */
+void ThreadPool::WorkerLoop(void*)
+{
+   State& state = GetState();
+
+   int node = -1; // node the thread is pinned to, or -1 if it isn't
+
+   state.mutex.lock();
+
+   while(true)
+   {
+      while (state.tasks.empty())
+      {
+         state.n_idle++;
+         state.task_cond.wait(state.mutex);
+         state.n_idle--;
+      }
+
+      Task task = state.tasks.front();
+      state.tasks.pop_front();
+      
+      int task_node = -1;
+      if (state.pin_threads && task.slot >= 0 && state.n_node > 1)
+         task_node = task.slot % state.n_node;
+
+      state.mutex.unlock();
+
+      if (task_node != node)
+      {
+         PinThread(state, task_node);
+         node = task_node;
+      }
+
+      task.fcn(task.param);
+      state.mutex.lock();
+   }
+}
+
+/**
+ * Set whether tasks with a slot are pinned to NUMA nodes, from the next 
+ * task. Has no effect with a single node or where it isn't supported
+ */
+void ThreadPool::SetPinThreads(bool pin_threads)
+{
+   State& state = GetState();
+   tthread::lock_guard<tthread::mutex> lock(state.mutex);
+   state.pin_threads = pin_threads;
+}
+
+#if defined(__linux__)
+
+/**
+ * Get the processors of each NUMA node
+ */
+static void GetNodeProcessors(std::vector<std::vector<int>>& nodes)
+{
+   for(int node=0; ; node++)
+   {
+      std::ostringstream path;
+      path << "/sys/devices/system/node/node" << node << "/cpulist";
+
+      std::ifstream f(path.str().c_str());
+      if (!f)
+         break;
+
+      // The list is of the form 0-7,16-23
+      std::vector<int> cpus;
+      std::string range;
+      while (std::getline(f, range, ','))
+      {
+         int first, last;
+         char dash;
+         std::istringstream r(range);
+         if (!(r >> first))
+            continue;
+         if (!(r >> dash >> last))
+            last = first;
+         for(int cpu=first; cpu<=last; cpu++)
+            cpus.push_back(cpu);
+      }
+
+      nodes.push_back(cpus);
+   }
+}
+
+#endif
+
+/**
+ * Create the pool's state. This happens before the first pool thread is 
+ * started, so the calling thread's affinity is that of the process
+ */
+ThreadPool::State* ThreadPool::CreateState()
+{
+   State* state = new State; // ok
+
+#if defined(_WIN32)
+
+   ULONG highest_node;
+   if (GetNumaHighestNodeNumber(&highest_node))
+      state->n_node = (int) highest_node + 1;
+
+#elif defined(__linux__)
+
+   cpu_set_t allowed;
+   if (pthread_getaffinity_np(pthread_self(), sizeof(allowed), &allowed) != 0)
+      return state;
+
+   for(int cpu=0; cpu<CPU_SETSIZE; cpu++)
+      if (CPU_ISSET(cpu, &allowed))
+         state->allowed_cpus.push_back(cpu);
+
+   // Only use nodes with processors we're allowed to run on
+   std::vector<std::vector<int>> nodes;
+   GetNodeProcessors(nodes);
+
+   for(size_t n=0; n<nodes.size(); n++)
+   {
+      std::vector<int> cpus;
+      for(size_t i=0; i<nodes[n].size(); i++)
+         if (nodes[n][i] < CPU_SETSIZE && CPU_ISSET(nodes[n][i], &allowed))
+            cpus.push_back(nodes[n][i]);
+
+      if (!cpus.empty())
+         state->node_cpus.push_back(cpus);
+   }
+
+   if (!state->node_cpus.empty())
+      state->n_node = (int) state->node_cpus.size();
+
+#endif
+
+   return state;
+}
+
+/**
+ * Restrict the calling thread to the processors of a NUMA node which are 
+ * allowed for the process, or if node is -1 allow it to use any of them again
+ */
+void ThreadPool::PinThread(State& state, int node)
+{
+#if defined(_WIN32)
+
+   DWORD_PTR process_mask, system_mask;
+   if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask))
+      return;
+
+   DWORD_PTR mask = process_mask;
+
+   ULONGLONG node_mask;
+   if (node >= 0 && GetNumaNodeProcessorMask((UCHAR) node, &node_mask) && (node_mask & process_mask))
+      mask = (DWORD_PTR) node_mask & process_mask;
+
+   SetThreadAffinityMask(GetCurrentThread(), mask);
+
+#elif defined(__linux__)
+
+   const std::vector<int>& cpus = (node >= 0 && node < (int) state.node_cpus.size()) ? state.node_cpus[node] : state.allowed_cpus;
+   if (cpus.empty())
+      return;
+
+   cpu_set_t set;
+   CPU_ZERO(&set);
+   for(size_t i=0; i<cpus.size(); i++)
+      CPU_SET(cpus[i], &set);
+
+   pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+#endif
+}
+
+/**
+ * Set the number of threads shared by all fits. Zero, the default, uses 
+ * the number of hardware threads (including hyperthreads)
+ */
+void ThreadPool::SetMaxThreads(int n_thread)
+{
+   State& state = GetState();
+   tthread::lock_guard<tthread::mutex> lock(state.mutex);
+   state.max_thread = n_thread;
+}
+
+int ThreadPool::GetMaxThreads(State& state)
+{
+   if (state.max_thread > 0)
+      return state.max_thread;
+
+   int n_hw = (int) tthread::thread::hardware_concurrency();
+   return (n_hw > 0) ? n_hw : 1;
+}
+
+/**
+ * Get the number of threads a fit would be entitled to if it were 
+ * started now
+ */
+int ThreadPool::GetFairShare()
+{
+   State& state = GetState();
+   tthread::lock_guard<tthread::mutex> lock(state.mutex);
+
+   int share = GetMaxThreads(state) / (state.n_job + 1);
+   return (share > 0) ? share : 1;
+}
+
+/**
+ * Start a job with n_thread fitter threads. job_threads holds the number of 
+ * threads the job is using and is only changed by the pool
+ */
+void ThreadPool::StartJob(int n_thread, int& job_threads)
+{
+   State& state = GetState();
+   tthread::lock_guard<tthread::mutex> lock(state.mutex);
+
+   state.n_job++;
+   state.n_busy += n_thread;
+   job_threads = n_thread;
+}
+
+void ThreadPool::FinishJob(int& job_threads)
+{
+   State& state = GetState();
+   tthread::lock_guard<tthread::mutex> lock(state.mutex);
+
+   state.n_job--;
+   state.n_busy -= job_threads;
+   job_threads = 0;
+}
+
+/**
+ * Set the number of threads a job is using, whether or not they are 
+ * available. Used when the job's fitter threads change
+ */
+void ThreadPool::SetJobThreads(int n_thread, int& job_threads)
+{
+   State& state = GetState();
+   tthread::lock_guard<tthread::mutex> lock(state.mutex);
+
+   state.n_busy += n_thread - job_threads;
+   job_threads = n_thread;
+}
+
+/**
+ * Take up to n_thread extra threads for a job, as long as the job stays 
+ * within its share and the budget isn't exceeded. Returns the number taken
+ */
+int ThreadPool::ReserveThreads(int n_thread, int& job_threads)
+{
+   State& state = GetState();
+   tthread::lock_guard<tthread::mutex> lock(state.mutex);
+
+   int max_thread = GetMaxThreads(state);
+   int share = max_thread / (state.n_job > 0 ? state.n_job : 1);
+   
+   int n = n_thread;
+   if (n > share - job_threads)
+      n = share - job_threads;
+   if (n > max_thread - state.n_busy)
+      n = max_thread - state.n_busy;
+   if (n < 0)
+      n = 0;
+
+   state.n_busy += n;
+   job_threads += n;
+   return n;
+}
+
+void ThreadPool::ReleaseThreads(int n_thread, int& job_threads)
+{
+   State& state = GetState();
+   tthread::lock_guard<tthread::mutex> lock(state.mutex);
+
+   state.n_busy -= n_thread;
+   job_threads -= n_thread;
+}
@@ -0,0 +1,117 @@
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+
+
+#ifndef _THREADPOOL_H
+#define _THREADPOOL_H
+
+#include <deque>
+#include <vector>
+#include "tinythread.h"
+
+/*
+   Process wide pool of threads which run the fitters and data loaders of 
+   every fit, so that starting a fit doesn't start a new set of threads 
+   (and the OpenMP teams the threads start are kept between fits). 
+
+   A task runs as soon as it is submitted: if there is no idle thread a 
+   new one is started, so the pool grows to the largest number of tasks 
+   which have run at once and tasks never wait for each other. Threads are
+   kept, waiting for work, until the process exits.
+
+   The pool also keeps the budget of threads which fits may use for 
+   fitting, shared fairly between the fits (jobs) running at once. Each 
+   job's fitter threads always count against the budget; the job can take 
+   extra threads for use within its regions only while it is below its 
+   share and the budget is not used up. The budget defaults to the number 
+   of hardware threads.
+
+   Optionally tasks submitted with a slot, such as a fit's fitters, are 
+   pinned to the processors of NUMA node slot % n_node, so that each fit's
+   fitters are spread over the nodes whichever pool threads run them. 
+   Buffers are first touched by the threads which use them (and on Linux by
+   the OpenMP teams they start, which inherit their node) so they stay 
+   local to them.
+*/
+class ThreadPool
+{
+public:
+
+   static void Run(void (*fcn)(void*), void* param, int slot = -1);
+
+   static void SetPinThreads(bool pin_threads);
+   static void SetMaxThreads(int n_thread);
+   static int GetFairShare();
+
+   static void StartJob(int n_thread, int& job_threads);
+   static void FinishJob(int& job_threads);
+   static void SetJobThreads(int n_thread, int& job_threads);
+   static int ReserveThreads(int n_thread, int& job_threads);
+   static void ReleaseThreads(int n_thread, int& job_threads);
+
+private:
+
+   struct Task
+   {
+      void (*fcn)(void*);
+      void* param;
+      int slot;
+   };
+
+   struct State
+   {
+      State() : n_idle(0), pin_threads(false), n_node(1), max_thread(0), n_busy(0), n_job(0) {}
+
+      std::deque<Task> tasks;
+      int n_idle;
+      bool pin_threads;
+
+      // Processors the process could use when the pool started, 
+      // and those of them on each NUMA node
+      int n_node;
+      std::vector<int> allowed_cpus;
+      std::vector<std::vector<int>> node_cpus;
+
+      int max_thread;
+      int n_busy;
+      int n_job;
+
+      tthread::mutex mutex;
+      tthread::condition_variable task_cond;
+   };
+
+   static State& GetState();
+   static State* CreateState();
+   static int GetMaxThreads(State& state);
+   static void WorkerLoop(void* param);
+   static void PinThread(State& state, int node);
+};
+
+#endif
@@ -0,0 +1,134 @@
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+
+#include "TransformCache.h"
+
+std::list<TransformCache::Entry> TransformCache::entries;
+double TransformCache::limit = 0;
+double TransformCache::used = 0;
+tthread::mutex TransformCache::mutex;
+
+size_t ScanData::Size() const
+{
+   size_t size = mask.size() * sizeof(mask_type);
+
+   for(size_t i=0; i<masked_px_idx.size(); i++)
+   {
+      size += masked_px_idx[i].size() * sizeof(int);
+      size += masked_px_intensity[i].size() * sizeof(float);
+      size += cached_data[i].size() * sizeof(float);
+      size += cached_data_f16[i].size() * sizeof(float16);
+      size += cached_r_ss[i].size() * sizeof(float);
+   }
+
+   return size;
+}
+
+/**
+ * Set the memory available to the cache. A limit of zero, the default, 
+ * disables the cache and releases any cached data
+ */
+void TransformCache::SetLimit(double limit_mb)
+{
+   tthread::lock_guard<tthread::mutex> lock(mutex);
+   limit = limit_mb * 1024 * 1024;
+   Trim();
+}
+
+bool TransformCache::IsEnabled()
+{
+   tthread::lock_guard<tthread::mutex> lock(mutex);
+   return limit > 0;
+}
+
+/**
+ * Find the data matching key, marking it as recently used
+ */
+std::shared_ptr<ScanData> TransformCache::Find(const std::vector<char>& key)
+{
+   tthread::lock_guard<tthread::mutex> lock(mutex);
+
+   for(std::list<Entry>::iterator it = entries.begin(); it != entries.end(); it++)
+   {
+      if (it->key == key)
+      {
+         entries.splice(entries.begin(), entries, it);
+         return it->data;
+      }
+   }
+
+   return std::shared_ptr<ScanData>();
+}
+
+/**
+ * Add data to the cache, replacing any existing entry for key. Data larger
+ * than the whole cache isn't stored
+ */
+void TransformCache::Store(const std::vector<char>& key, std::shared_ptr<ScanData> data)
+{
+   size_t size = data->Size() + key.size();
+
+   tthread::lock_guard<tthread::mutex> lock(mutex);
+
+   if (size > limit)
+      return;
+
+   for(std::list<Entry>::iterator it = entries.begin(); it != entries.end(); it++)
+   {
+      if (it->key == key)
+      {
+         used -= it->size;
+         entries.erase(it);
+         break;
+      }
+   }
+
+   Entry entry;
+   entry.key = key;
+   entry.data = data;
+   entry.size = size;
+
+   entries.push_front(entry);
+   used += size;
+
+   Trim();
+}
+
+/**
+ * Drop the least recently used entries until we're within the limit
+ */
+void TransformCache::Trim()
+{
+   while (!entries.empty() && used > limit)
+   {
+      used -= entries.back().size;
+      entries.pop_back();
+   }
+}
@@ -0,0 +1,96 @@
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+
+#ifndef _TRANSFORMCACHE_H
+#define _TRANSFORMCACHE_H
+
+#include <vector>
+#include <list>
+#include <memory>
+#include "DataTypes.h"
+#include "FLIMGlobalAnalysis.h"
+#include "tinythread.h"
+
+/**
+ * The result of scanning a dataset, indexed by position in use_im: the 
+ * pixels of each image which pass the masks, their intensities, the 
+ * transformed decays of the images which fit in the cache and the mask
+ * of each image after scanning
+ */
+struct ScanData
+{
+   std::vector< std::vector<int> >     masked_px_idx;
+   std::vector< std::vector<float> >   masked_px_intensity;
+   std::vector< std::vector<float> >   cached_data;
+   std::vector< std::vector<float16> > cached_data_f16;
+   std::vector< std::vector<float> >   cached_r_ss;
+   std::vector<mask_type>              mask;
+
+   size_t Size() const;
+};
+
+/*
+   Process wide cache of scanned and transformed datasets, so that fits 
+   which only change the model can share the transformed data of an 
+   earlier fit instead of reading and transforming it again. 
+
+   Entries are keyed on a description of the data source and all the 
+   parameters the transformed data depends on. The least recently used 
+   entries are dropped once the cache grows past its limit; entries still 
+   in use by a fit are kept alive by the fit until it's finished with them.
+*/
+class TransformCache
+{
+public:
+
+   static void SetLimit(double limit_mb);
+   static bool IsEnabled();
+
+   static std::shared_ptr<ScanData> Find(const std::vector<char>& key);
+   static void Store(const std::vector<char>& key, std::shared_ptr<ScanData> data);
+
+private:
+
+   struct Entry
+   {
+      std::vector<char> key;
+      std::shared_ptr<ScanData> data;
+      size_t size;
+   };
+
+   static void Trim();
+
+   static std::list<Entry> entries;
+   static double limit;
+   static double used;
+   static tthread::mutex mutex;
+};
+
+#endif
@@ -0,0 +1,157 @@
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK 
+// Engineering and Physical Sciences Council 
+// through  a studentship from the Institute of Chemical Biology 
+// and The Wellcome Trust through a grant entitled 
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+#ifndef _TRANSFORMKERNEL_H
+#define _TRANSFORMKERNEL_H
+
+#include "FlagDefinitions.h"
+#include "DataTypes.h"
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE_KERNEL
+#include <emmintrin.h>
+#endif
+
+#ifdef USE_SSE_KERNEL
+
+/**
+ * Load four consecutive values as floats
+ */
+inline __m128 LoadAsFloat(const float* src)
+{
+   return _mm_loadu_ps(src);
+}
+
+inline __m128 LoadAsFloat(const uint16_t* src)
+{
+   __m128i v = _mm_loadl_epi64((const __m128i*) src);
+   v = _mm_unpacklo_epi16(v, _mm_setzero_si128());
+   return _mm_cvtepi32_ps(v);
+}
+
+inline __m128 LoadAsFloat(const uint8_t* src)
+{
+   int32_t packed;
+   memcpy(&packed, src, sizeof(packed));
+   __m128i v = _mm_cvtsi32_si128(packed);
+   v = _mm_unpacklo_epi8(v, _mm_setzero_si128());
+   v = _mm_unpacklo_epi16(v, _mm_setzero_si128());
+   return _mm_cvtepi32_ps(v);
+}
+
+inline __m128 LoadAsFloat(const float16* src)
+{
+   // Move the exponent and mantissa into place and rescale the exponent
+   // with a multiply, then patch up inf/nan and the sign
+   __m128i h = _mm_loadl_epi64((const __m128i*) src);
+   h = _mm_unpacklo_epi16(h, _mm_setzero_si128());
+
+   __m128i expmant = _mm_and_si128(h, _mm_set1_epi32(0x7FFF));
+   __m128i sign    = _mm_slli_epi32(_mm_xor_si128(h, expmant), 16);
+   __m128  scaled  = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expmant, 13)), 
+                                _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)));
+   __m128i infnan  = _mm_cmpgt_epi32(expmant, _mm_set1_epi32(0x7BFF));
+   __m128  infnan_exp = _mm_and_ps(_mm_castsi128_ps(infnan), _mm_castsi128_ps(_mm_set1_epi32(255 << 23)));
+
+   return _mm_or_ps(scaled, _mm_or_ps(_mm_castsi128_ps(sign), infnan_exp));
+}
+
+inline __m128 LoadAsFloat(const uint32_t* src)
+{
+   // SSE2 only converts signed integers, so convert the high and low 
+   // halves separately; the sum is rounded once so the result is exact
+   __m128i v  = _mm_loadu_si128((const __m128i*) src);
+   __m128i hi = _mm_srli_epi32(v, 16);
+   __m128i lo = _mm_and_si128(v, _mm_set1_epi32(0xFFFF));
+   __m128 hi_f = _mm_mul_ps(_mm_cvtepi32_ps(hi), _mm_set1_ps(65536.0f));
+   return _mm_add_ps(hi_f, _mm_cvtepi32_ps(lo));
+}
+
+#endif
+
+/**
+ * Convert n values from src to float, subtract the background, scale to 
+ * photons and set negative values to zero in a single pass over the data.
+ * The background is bg_const for BG_VALUE and BG_IMAGE, and 
+ * (bg_profile[i] * bg_weight + bg_const) * bg_area for BG_TV_IMAGE.
+ * src and dst may be the same
+ */
+template <int bg_type, typename T>
+void TransformSpan(const T* src, float* dst, int n, float scale, float bg_const = 0, 
+                   const float* bg_profile = NULL, float bg_weight = 0, float bg_area = 1)
+{
+   int i = 0;
+
+#ifdef USE_SSE_KERNEL
+   __m128 scale_  = _mm_set1_ps(scale);
+   __m128 const_  = _mm_set1_ps(bg_const);
+   __m128 weight_ = _mm_set1_ps(bg_weight);
+   __m128 area_   = _mm_set1_ps(bg_area);
+   __m128 zero_   = _mm_setzero_ps();
+
+   for(; i+4<=n; i+=4)
+   {
+      __m128 v = LoadAsFloat(src+i);
+
+      if (bg_type == BG_VALUE || bg_type == BG_IMAGE)
+      {
+         v = _mm_sub_ps(v, const_);
+      }
+      else if (bg_type == BG_TV_IMAGE)
+      {
+         __m128 b = _mm_mul_ps(_mm_loadu_ps(bg_profile+i), weight_);
+         b = _mm_mul_ps(_mm_add_ps(b, const_), area_);
+         v = _mm_sub_ps(v, b);
+      }
+
+      v = _mm_mul_ps(v, scale_);
+
+      // Keeps NaNs, as the scalar comparison below does
+      v = _mm_max_ps(zero_, v);
+
+      _mm_storeu_ps(dst+i, v);
+   }
+#endif
+
+   for(; i<n; i++)
+   {
+      float v = (float) src[i];
+
+      if (bg_type == BG_VALUE || bg_type == BG_IMAGE)
+         v -= bg_const;
+      else if (bg_type == BG_TV_IMAGE)
+         v -= (bg_profile[i] * bg_weight + bg_const) * bg_area;
+
+      v *= scale;
+      dst[i] = (v < 0) ? 0 : v;
+   }
+}
+
+#endif
@@ -0,0 +1,245 @@
+//=========================================================================
+//
+// Copyright (C) 2013 Imperial College London.
+// All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// This software tool was developed with support from the UK
+// Engineering and Physical Sciences Council
+// through  a studentship from the Institute of Chemical Biology
+// and The Wellcome Trust through a grant entitled
+// "The Open Microscopy Environment: Image Informatics for Biological Sciences" (Ref: 095931).
+//
+// Author : Sean Warren
+//
+//=========================================================================
+
+#include <boost/test/unit_test.hpp>
+
+#include "CompressedData.h"
+#include "FlagDefinitions.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+namespace
+{
+   const char* test_file = "CompressedDataTest.dat";
+
+   const int n_im     = 3;
+   const int n_px     = 37;
+   const int n_meas   = 16;
+   const int block_px = 8;
+
+   const uint8_t fill_byte = 0xA5;
+
+   void ReadFile(const char* filename, vector<char>& buf)
+   {
+      buf.clear();
+
+      FILE* fp = fopen(filename, "rb");
+      BOOST_REQUIRE( fp != NULL );
+
+      char chunk[4096];
+      size_t n;
+      while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+         buf.insert(buf.end(), chunk, chunk + n);
+
+      fclose(fp);
+   }
+
+   /*
+      Write data to a container, read it back and check every image decodes
+      to the original data, both whole and for pixel ranges which start and
+      end part way through a block. Returns the codec used
+   */
+   template <typename T>
+   int CheckRoundTrip(const vector<T>& data, int data_class)
+   {
+      int e = CompressedData::Write(test_file, &data[0], data_class, n_im, n_px, n_meas, block_px);
+      BOOST_REQUIRE_EQUAL( e, SUCCESS );
+
+      vector<char> file;
+      ReadFile(test_file, file);
+      remove(test_file);
+
+      CompressedData cd;
+      e = cd.Open(&file[0], file.size());
+      BOOST_REQUIRE_EQUAL( e, SUCCESS );
+
+      BOOST_CHECK_EQUAL( cd.GetDataClass(), data_class );
+      BOOST_CHECK_EQUAL( cd.GetNumImages(), n_im );
+      BOOST_CHECK_EQUAL( cd.GetNumPixels(), n_px );
+      BOOST_CHECK_EQUAL( cd.GetNumMeas(), n_meas );
+
+      size_t n_im_values = (size_t) n_px * n_meas;
+      vector<T> decoded(n_im_values);
+
+      for(int im=0; im<n_im; im++)
+      {
+         const T* expected = &data[im * n_im_values];
+
+         e = cd.DecodeImage(im, &decoded[0]);
+         BOOST_CHECK_EQUAL( e, SUCCESS );
+         BOOST_CHECK( memcmp(&decoded[0], expected, n_im_values * sizeof(T)) == 0 );
+
+         // Only the blocks covering the range should be written
+         int ranges[][2] = { {0, 1}, {3, 13}, {8, 16}, {15, 17}, {30, n_px} };
+         for(int r=0; r<5; r++)
+         {
+            int px0 = ranges[r][0], px1 = ranges[r][1];
+            int b0  = (px0 / block_px) * block_px;
+            int b1  = min(((px1 + block_px - 1) / block_px) * block_px, n_px);
+
+            memset(&decoded[0], fill_byte, n_im_values * sizeof(T));
+            e = cd.DecodeImage(im, &decoded[0], px0, px1);
+            BOOST_CHECK_EQUAL( e, SUCCESS );
+
+            size_t v0 = (size_t) b0 * n_meas;
+            size_t v1 = (size_t) b1 * n_meas;
+            BOOST_CHECK( memcmp(&decoded[v0], expected + v0, (v1 - v0) * sizeof(T)) == 0 );
+
+            const uint8_t* bytes = (const uint8_t*) &decoded[0];
+            bool untouched = true;
+            for(size_t i=0; i<v0 * sizeof(T); i++)
+               untouched &= (bytes[i] == fill_byte);
+            for(size_t i=v1 * sizeof(T); i<n_im_values * sizeof(T); i++)
+               untouched &= (bytes[i] == fill_byte);
+            BOOST_CHECK( untouched );
+         }
+      }
+
+      BOOST_CHECK( cd.DecodeImage(n_im, &decoded[0]) != SUCCESS );
+
+      CompressedDataHeader h;
+      memcpy(&h, &file[0], sizeof(h));
+      return h.codec;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( CompressedData_Delta_UINT16 )
+{
+   vector<uint16_t> data((size_t) n_im * n_px * n_meas);
+   for(size_t i=0; i<data.size(); i++)
+      data[i] = (uint16_t) ((i * 7919) % 65536);
+
+   int codec = CheckRoundTrip(data, DATA_UINT16);
+   BOOST_CHECK_EQUAL( codec, CODEC_DELTA_VARINT );
+}
+
+BOOST_AUTO_TEST_CASE( CompressedData_Delta_UINT32 )
+{
+   vector<uint32_t> data((size_t) n_im * n_px * n_meas);
+   for(size_t i=0; i<data.size(); i++)
+      data[i] = (uint32_t) (i * 2654435761u);
+
+   int codec = CheckRoundTrip(data, DATA_UINT32);
+   BOOST_CHECK_EQUAL( codec, CODEC_DELTA_VARINT );
+}
+
+BOOST_AUTO_TEST_CASE( CompressedData_Delta_FLOAT )
+{
+   // Float data holding only integers is delta coded
+   vector<float> data((size_t) n_im * n_px * n_meas);
+   for(size_t i=0; i<data.size(); i++)
+      data[i] = (float) ((i * 31) % 1000);
+
+   int codec = CheckRoundTrip(data, DATA_FLOAT);
+   BOOST_CHECK_EQUAL( codec, CODEC_DELTA_VARINT );
+}
+
+BOOST_AUTO_TEST_CASE( CompressedData_Raw_FLOAT )
+{
+   vector<float> data((size_t) n_im * n_px * n_meas);
+   for(size_t i=0; i<data.size(); i++)
+      data[i] = 0.25f * (float) ((i * 31) % 1000);
+
+   int codec = CheckRoundTrip(data, DATA_FLOAT);
+   BOOST_CHECK_EQUAL( codec, CODEC_RAW );
+}
+
+BOOST_AUTO_TEST_CASE( CompressedData_Invalid_Offsets )
+{
+   vector<uint16_t> data((size_t) n_im * n_px * n_meas);
+   for(size_t i=0; i<data.size(); i++)
+      data[i] = (uint16_t) (i % 1000);
+
+   int e = CompressedData::Write(test_file, &data[0], DATA_UINT16, n_im, n_px, n_meas, block_px);
+   BOOST_REQUIRE_EQUAL( e, SUCCESS );
+
+   vector<char> file;
+   ReadFile(test_file, file);
+   remove(test_file);
+
+   int n_block = n_im * ((n_px + block_px - 1) / block_px);
+   size_t index_end = sizeof(CompressedDataHeader) + (n_block + 1) * sizeof(uint64_t);
+   uint64_t* offset = (uint64_t*) &file[sizeof(CompressedDataHeader)];
+
+   CompressedData cd;
+   BOOST_CHECK_EQUAL( cd.Open(&file[0], file.size()), SUCCESS );
+
+   // First block overlapping the index
+   vector<char> bad = file;
+   ((uint64_t*) &bad[sizeof(CompressedDataHeader)])[0] = index_end - 1;
+   BOOST_CHECK( cd.Open(&bad[0], bad.size()) != SUCCESS );
+
+   // Blocks out of order
+   bad = file;
+   uint64_t* bad_offset = (uint64_t*) &bad[sizeof(CompressedDataHeader)];
+   bad_offset[2] = offset[3] + 1;
+   BOOST_CHECK( cd.Open(&bad[0], bad.size()) != SUCCESS );
+
+   // Last block past the end of the file
+   BOOST_CHECK( cd.Open(&file[0], file.size() - 1) != SUCCESS );
+}
+
+BOOST_AUTO_TEST_CASE( CompressedData_Truncated_Block )
+{
+   // Integer data is delta coded, fractional float data is stored raw
+   vector<uint16_t> data_int((size_t) n_im * n_px * n_meas);
+   vector<float> data_float(data_int.size());
+   for(size_t i=0; i<data_int.size(); i++)
+   {
+      data_int[i] = (uint16_t) (i % 1000);
+      data_float[i] = 0.5f * (float) (i % 1000);
+   }
+
+   for(int c=0; c<2; c++)
+   {
+      int e = (c == 0) ? CompressedData::Write(test_file, &data_int[0], DATA_UINT16, n_im, n_px, n_meas, block_px) :
+                         CompressedData::Write(test_file, &data_float[0], DATA_FLOAT, n_im, n_px, n_meas, block_px);
+      BOOST_REQUIRE_EQUAL( e, SUCCESS );
+
+      vector<char> file;
+      ReadFile(test_file, file);
+      remove(test_file);
+
+      // Cut the first block short
+      uint64_t* offset = (uint64_t*) &file[sizeof(CompressedDataHeader)];
+      offset[1] = offset[0] + (offset[1] - offset[0]) / 2;
+
+      CompressedData cd;
+      BOOST_REQUIRE_EQUAL( cd.Open(&file[0], file.size()), SUCCESS );
+
+      vector<float> decoded((size_t) n_px * n_meas);
+      BOOST_CHECK( cd.DecodeImage(0, &decoded[0]) != SUCCESS );
+      BOOST_CHECK( cd.DecodeImage(0, &decoded[0], 0, block_px) != SUCCESS );
+   }
+}